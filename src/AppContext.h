@@ -1,14 +1,25 @@
 #ifndef PIXELS_APPCONTEXT_H
 #define PIXELS_APPCONTEXT_H
 
+#include "camera.h"
+#include "capture.h"
 #include "definitions.h"
+#include "mipmap.h"
+#include "perf_counters.h"
 #include "util.h"
+#include "world.h"
+
+#ifdef PIXELS_SHM
+#include "shm_publisher.h"
+#endif
 
 #include <SDL3/SDL_init.h>
 #include <SDL3/SDL_pixels.h>
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_video.h>
 #include <array>
+#include <memory>
+#include <vector>
 
 struct Cursor {
     enum class BrushShape {
@@ -27,15 +38,24 @@ struct Cursor {
 };
 
 struct AppContext {
-    std::array<std::array<cell_t, level_size.x>, level_size.y> cells;
+    World world;
+    MipChain mips;
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *frame_buffer;
+    // Painted on the CPU and then uploaded, since the memory SDL_LockTexture hands out is write only and may live in an
+    // upload buffer that is slow to read back from
+    std::vector<SDL_Color> frame = std::vector<SDL_Color>(static_cast<size_t>(level_size.x) * level_size.y);
     SDL_AppResult app_quit = SDL_APP_CONTINUE;
-    Random rng;
     Cursor cursor;
+    Camera camera;
+    std::unique_ptr<FrameCapture> capture;
+    std::unique_ptr<PerfCounters> perf;
+#ifdef PIXELS_SHM
+    std::unique_ptr<SharedFramePublisher> publisher;
+#endif
 
-    AppContext(SDL_Window *window, SDL_Renderer *renderer) : window(window), renderer(renderer), rng() {
+    AppContext(SDL_Window *window, SDL_Renderer *renderer) : window(window), renderer(renderer) {
         frame_buffer = SDL_CreateTexture(
             renderer,
             SDL_PIXELFORMAT_RGBA32,
@@ -46,10 +66,6 @@ struct AppContext {
         if (not frame_buffer) {
             SDL_Fail();
         }
-        for (auto &row : cells) {
-            //            row.fill(cell_t({0, 0}, Material::Sand, true, true));
-            row.fill(air_cell);
-        }
     }
 
     ~AppContext() {
@@ -0,0 +1,464 @@
+#include "batch.h"
+#include "definitions.h"
+#include "image.h"
+#include "perf_counters.h"
+#include "simulator.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_pixels.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static constexpr std::array material_names{ "Air", "Sand", "Water", "RedSand" };
+static_assert(material_names.size() == material_count);
+
+static std::optional<Material> parse_material(const std::string_view name) {
+    for (size_t i = 0; i < material_names.size(); i++) {
+        std::string_view candidate = material_names[i];
+        if (std::ranges::equal(name, candidate, [](const char a, const char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            })) {
+            return static_cast<Material>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+template <typename T> static bool parse_number(const std::string_view text, T &value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} and end == text.data() + text.size();
+}
+
+// std::from_chars for floating point is still missing from some standard libraries
+static bool parse_float(const std::string_view text, float &value) {
+    std::string copy(text);
+    char *end = nullptr;
+    value = std::strtof(copy.c_str(), &end);
+    return not copy.empty() and end == copy.c_str() + copy.size();
+}
+
+static std::vector<std::string_view> split(const std::string_view text, const char separator) {
+    std::vector<std::string_view> parts;
+    size_t start = 0;
+    while (true) {
+        auto end = text.find(separator, start);
+        parts.push_back(text.substr(start, end - start));
+        if (end == std::string_view::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+static bool parse_brush(const std::string_view text, BrushCommand &brush) {
+    auto parts = split(text, ':');
+    if (parts.size() != 4) {
+        return false;
+    }
+
+    auto position = split(parts[2], ',');
+    auto material = parse_material(parts[1]);
+    if (position.size() != 2 or not material) {
+        return false;
+    }
+
+    brush.material = *material;
+    return parse_number(parts[0], brush.tick) and parse_number(position[0], brush.centre.x)
+           and parse_number(position[1], brush.centre.y) and parse_number(parts[3], brush.radius) and brush.radius > 0;
+}
+
+static bool parse_option(const std::string_view key, const std::string_view value, WorldConfig &config) {
+    if (key == "seed") {
+        return parse_number(value, config.seed);
+    }
+    if (key == "ticks") {
+        return parse_number(value, config.ticks);
+    }
+    if (key == "snapshot") {
+        return parse_number(value, config.snapshot_interval);
+    }
+    if (key == "brush") {
+        BrushCommand brush{};
+        if (not parse_brush(value, brush)) {
+            return false;
+        }
+        config.brushes.push_back(brush);
+        return true;
+    }
+
+    // Material table overrides look like density.Water=1.2
+    auto dot = key.find('.');
+    if (dot == std::string_view::npos) {
+        return false;
+    }
+
+    auto material = parse_material(key.substr(dot + 1));
+    if (not material) {
+        return false;
+    }
+
+    auto property = key.substr(0, dot);
+    auto index = std::to_underlying(*material);
+    if (property == "density") {
+        return parse_float(value, config.materials.density[index]) and config.materials.density[index] >= 0.f;
+    }
+    if (property == "slipperiness") {
+        return parse_number(value, config.materials.slipperiness[index]) and config.materials.slipperiness[index] >= 0;
+    }
+    return false;
+}
+
+std::optional<std::vector<WorldConfig>> parse_batch_file(const std::filesystem::path &path) {
+    std::ifstream file(path);
+    if (not file) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Could not open batch file %s", path.string().c_str());
+        return std::nullopt;
+    }
+
+    std::vector<WorldConfig> configs;
+    std::set<std::string> names;
+    std::string line;
+    for (auto line_number{ 1 }; std::getline(file, line); line_number++) {
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (not(tokens >> keyword) or keyword.starts_with('#')) {
+            continue;
+        }
+
+        auto fail = [&](const char *reason, const std::string &token) {
+            SDL_LogError(
+                SDL_LOG_CATEGORY_CUSTOM,
+                "%s:%d: %s '%s'",
+                path.string().c_str(),
+                line_number,
+                reason,
+                token.c_str()
+            );
+            return std::nullopt;
+        };
+
+        if (keyword != "world") {
+            return fail("unknown keyword", keyword);
+        }
+
+        WorldConfig config;
+        config.seed = line_number;
+        // The name becomes a directory, so keep it to characters that are safe everywhere
+        if (not(tokens >> config.name) or not std::ranges::all_of(config.name, [](const char c) {
+                return std::isalnum(static_cast<unsigned char>(c)) or c == '-' or c == '_';
+            })) {
+            return fail("invalid world name", config.name);
+        }
+        if (not names.insert(config.name).second) {
+            return fail("duplicate world name", config.name);
+        }
+
+        std::string token;
+        while (tokens >> token) {
+            std::string_view option = token;
+            auto equals = option.find('=');
+            if (equals == std::string_view::npos) {
+                return fail("invalid option", token);
+            }
+            if (not parse_option(option.substr(0, equals), option.substr(equals + 1), config)) {
+                return fail("invalid option", token);
+            }
+        }
+
+        std::ranges::stable_sort(config.brushes, {}, &BrushCommand::tick);
+        configs.push_back(std::move(config));
+    }
+
+    if (configs.empty()) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "%s does not describe any worlds", path.string().c_str());
+        return std::nullopt;
+    }
+
+    return configs;
+}
+
+struct WorldRun {
+    const WorldConfig *config;
+    std::filesystem::path directory;
+    std::unique_ptr<World> world;
+    std::ofstream stats;
+    size_t next_brush = 0;
+    std::chrono::steady_clock::duration busy{};
+};
+
+// One set of counters per worker thread, since perf_event_open counts the thread that opened it
+struct WorkerCounters {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<PerfCounters>> counters;
+};
+
+static thread_local PerfCounters *worker_counters = nullptr;
+
+/*
+ * Writes the snapshots of every world in the batch. Encoding runs as a task on the pool, so a slice only pays for
+ * turning cells into colours. There is a fixed number of buffers; once they are all waiting for the disk, the slice
+ * that wants another snapshot encodes it itself. That slows the simulation down to what the disk can keep up with,
+ * and unlike a live capture nothing is ever dropped.
+ */
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const size_t buffer_count) {
+        buffers.resize(buffer_count);
+        for (auto &buffer : buffers) {
+            buffer.resize(static_cast<size_t>(level_size.x) * level_size.y);
+            free_buffers.push_back(&buffer);
+        }
+    }
+
+    void write(WorkStealingPool &pool, const World &world, std::filesystem::path path) {
+        auto *buffer = acquire();
+        if (not buffer) {
+            static thread_local std::vector<SDL_Color> scratch(static_cast<size_t>(level_size.x) * level_size.y);
+            paint(world, scratch);
+            encode(path, scratch);
+            return;
+        }
+
+        paint(world, *buffer);
+        pool.submit([this, buffer, path = std::move(path)] {
+            encode(path, *buffer);
+            release(buffer);
+        });
+    }
+
+    uint64_t failures() const {
+        return failed.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<SDL_Color> *acquire() {
+        std::scoped_lock lock(mutex);
+        if (free_buffers.empty()) {
+            return nullptr;
+        }
+        auto *buffer = free_buffers.back();
+        free_buffers.pop_back();
+        return buffer;
+    }
+
+    void release(std::vector<SDL_Color> *buffer) {
+        std::scoped_lock lock(mutex);
+        free_buffers.push_back(buffer);
+    }
+
+    // Air is transparent in material_colour, so blend over the same background the window clears to
+    static void paint(const World &world, std::vector<SDL_Color> &pixels) {
+        std::array<SDL_Color, material_count> palette;
+        for (size_t i = 0; i < material_count; i++) {
+            palette[i] = composite_over(material_colour[i], background_colour);
+        }
+
+        for (auto y{ 0 }; y < level_size.y; y++) {
+            for (auto x{ 0 }; x < level_size.x; x++) {
+                pixels[y * level_size.x + x] = palette[std::to_underlying(world.cells[y][x].material)];
+            }
+        }
+    }
+
+    void encode(const std::filesystem::path &path, const std::vector<SDL_Color> &pixels) {
+        if (not write_png(path, pixels.data(), level_size)) {
+            SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Could not write snapshot %s", path.string().c_str());
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Never resized after construction, so pointers into it stay valid
+    std::vector<std::vector<SDL_Color>> buffers;
+    std::mutex mutex;
+    std::vector<std::vector<SDL_Color> *> free_buffers;
+    std::atomic<uint64_t> failed = 0;
+};
+
+static void record(WorkStealingPool &pool, WorldRun &run, SnapshotWriter &snapshots) {
+    const auto &world = *run.world;
+
+    run.stats << world.tick << ',' << world.census.moves();
+    for (size_t i = 0; i < material_count; i++) {
+        run.stats << ',' << world.census.total(static_cast<Material>(i));
+    }
+    run.stats << '\n';
+
+    char name[32];
+    snprintf(name, sizeof(name), "frame-%06llu.png", static_cast<unsigned long long>(world.tick));
+    snapshots.write(pool, world, run.directory / name);
+}
+
+static void run_slice(
+    WorkStealingPool &pool,
+    WorldRun &run,
+    SnapshotWriter &snapshots,
+    const BatchOptions &options,
+    WorkerCounters *counters
+) {
+    auto begin = std::chrono::steady_clock::now();
+    auto &world = *run.world;
+    const auto &config = *run.config;
+
+    if (counters and not worker_counters) {
+        std::scoped_lock lock(counters->mutex);
+        worker_counters = counters->counters.emplace_back(std::make_unique<PerfCounters>(0)).get();
+    }
+
+    auto slice_end = std::min(world.tick + options.slice, config.ticks);
+    while (world.tick < slice_end) {
+        while (run.next_brush < config.brushes.size() and config.brushes[run.next_brush].tick <= world.tick) {
+            const auto &brush = config.brushes[run.next_brush++];
+            paint_brush(world, brush.centre, brush.radius, brush.material);
+        }
+
+        {
+            PerfPhase phase(worker_counters, PerfCounters::Phase::Physics);
+            step_world(world);
+        }
+        world.end_tick();
+        if (worker_counters) {
+            worker_counters->end_tick();
+        }
+
+        if (world.tick == config.ticks
+            or (config.snapshot_interval > 0 and world.tick % config.snapshot_interval == 0)) {
+            record(pool, run, snapshots);
+        }
+    }
+
+    run.busy += std::chrono::steady_clock::now() - begin;
+
+    if (world.tick < config.ticks) {
+        pool.submit([&pool, &run, &snapshots, &options, counters] {
+            run_slice(pool, run, snapshots, options, counters);
+        });
+    }
+}
+
+bool run_batch(const std::vector<WorldConfig> &configs, const BatchOptions &options) {
+    std::vector<std::unique_ptr<WorldRun>> runs;
+    for (const auto &config : configs) {
+        auto run = std::make_unique<WorldRun>();
+        run->config = &config;
+        run->directory = options.output / config.name;
+
+        std::error_code error;
+        std::filesystem::create_directories(run->directory, error);
+        run->stats.open(run->directory / "stats.csv");
+        if (error or not run->stats) {
+            SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Could not set up %s", run->directory.string().c_str());
+            return false;
+        }
+
+        run->stats << "tick,moves";
+        for (const auto *name : material_names) {
+            run->stats << ',' << name;
+        }
+        run->stats << '\n';
+
+        run->world = std::make_unique<World>(config.seed);
+        run->world->materials = config.materials;
+        runs.push_back(std::move(run));
+    }
+
+    std::unique_ptr<WorkerCounters> counters;
+    if (options.perf_counters) {
+        // Probe once up front so a machine without counters does not get a warning from every worker
+        if (PerfCounters(0).available()) {
+            counters = std::make_unique<WorkerCounters>();
+        }
+    }
+
+    auto threads = options.threads > 0 ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    SDL_Log(
+        "Running %llu worlds on %llu threads",
+        static_cast<unsigned long long>(runs.size()),
+        static_cast<unsigned long long>(threads)
+    );
+
+    // Two buffers per thread keeps every worker busy while a few snapshots wait for the disk
+    SnapshotWriter snapshots(threads * 2);
+    auto begin = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads);
+        for (auto &run : runs) {
+            pool.submit([&pool, &run = *run, &snapshots, &options, counters = counters.get()] {
+                run_slice(pool, run, snapshots, options, counters);
+            });
+        }
+        // Snapshot tasks count as pending too, so every snapshot is on disk once this returns
+        pool.wait();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (snapshots.failures() > 0) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_CUSTOM,
+            "%llu snapshots could not be written",
+            static_cast<unsigned long long>(snapshots.failures())
+        );
+    }
+
+    std::ofstream summary(options.output / "summary.csv");
+    summary << "name,seed,ticks,hash,moves";
+    for (const auto *name : material_names) {
+        summary << ',' << name;
+    }
+    summary << ",busy_ms\n";
+
+    uint64_t total_ticks = 0;
+    for (const auto &run : runs) {
+        const auto &world = *run->world;
+        char hash[20];
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(world.hash()));
+
+        summary << run->config->name << ',' << run->config->seed << ',' << world.tick << ',' << hash << ','
+                << world.census.moves();
+        for (size_t i = 0; i < material_count; i++) {
+            summary << ',' << world.census.total(static_cast<Material>(i));
+        }
+        summary << ',' << std::chrono::duration_cast<std::chrono::milliseconds>(run->busy).count() << '\n';
+        total_ticks += world.tick;
+    }
+
+    SDL_Log(
+        "Batch finished: %llu ticks in %.2f s (%.1f ticks/s), results in %s",
+        static_cast<unsigned long long>(total_ticks),
+        elapsed,
+        elapsed > 0 ? static_cast<double>(total_ticks) / elapsed : 0.0,
+        options.output.string().c_str()
+    );
+
+    if (counters) {
+        for (size_t i = 0; i < counters->counters.size(); i++) {
+            SDL_Log(
+                "Worker %llu performance counters, average per tick:\n%s",
+                static_cast<unsigned long long>(i),
+                counters->counters[i]->summary().c_str()
+            );
+        }
+    }
+
+    return static_cast<bool>(summary) and snapshots.failures() == 0;
+}
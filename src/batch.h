@@ -0,0 +1,59 @@
+#ifndef PIXELS_BATCH_H
+#define PIXELS_BATCH_H
+
+#include "definitions.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <glm/ext/vector_int2.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+ * Headless batch mode: many independent worlds in one process, scheduled on a shared work-stealing pool.
+ *
+ * Worlds are described in a plain text file, one per line. Blank lines and lines starting with # are ignored.
+ *
+ *     world <name> [seed=<n>] [ticks=<n>] [snapshot=<n>]
+ *                  [density.<material>=<value>] [slipperiness.<material>=<value>]
+ *                  [brush=<tick>:<material>:<x>,<y>:<radius>]...
+ *
+ * ticks is the world's budget (1000 by default) and seed defaults to the world's line number. Every snapshot ticks,
+ * and once at the end, a row is appended to <out>/<name>/stats.csv and frame-<tick>.png is written next to it. A
+ * brush entry paints a square of the material (Air erases) just before the given tick, exactly like the mouse does. A
+ * summary of every world is written to <out>/summary.csv once they have all finished.
+ */
+
+struct BrushCommand {
+    uint64_t tick;
+    Material material;
+    glm::ivec2 centre;
+    int radius;
+};
+
+struct WorldConfig {
+    std::string name;
+    uint64_t seed = 0;
+    uint64_t ticks = 1000;
+    uint64_t snapshot_interval = 0;
+    MaterialTable materials;
+    // Sorted by tick
+    std::vector<BrushCommand> brushes;
+};
+
+struct BatchOptions {
+    std::filesystem::path output = "batch-output";
+    // 0 uses every hardware thread
+    size_t threads = 0;
+    // Ticks a world runs for before going back into the pool, so long worlds cannot starve short ones
+    uint64_t slice = 32;
+    bool perf_counters = false;
+};
+
+std::optional<std::vector<WorldConfig>> parse_batch_file(const std::filesystem::path &path);
+
+bool run_batch(const std::vector<WorldConfig> &configs, const BatchOptions &options);
+
+#endif // PIXELS_BATCH_H
@@ -0,0 +1,88 @@
+#ifndef PIXELS_CAMERA_H
+#define PIXELS_CAMERA_H
+
+#include "definitions.h"
+
+#include <algorithm>
+#include <glm/ext/vector_int2.hpp>
+#include <utility>
+
+/*
+ * Maps between screen pixels (the frame buffer, which is always level_size) and level cells.
+ *
+ * Zoom is a power of two so that every screen pixel lines up exactly with either a block of screen pixels per cell
+ * (zoom > 0) or a single texel of a mip level (zoom < 0). position is the cell shown in the top left corner.
+ */
+struct Camera {
+    glm::ivec2 position{ 0, 0 };
+    int zoom = 0;
+
+    glm::ivec2 to_world(const glm::ivec2 screen) const {
+        return position + scale_to_world(screen, zoom);
+    }
+
+    glm::ivec2 to_screen(const glm::ivec2 world) const {
+        auto offset = world - position;
+        if (zoom >= 0) {
+            return { offset.x << zoom, offset.y << zoom };
+        }
+        return { offset.x >> -zoom, offset.y >> -zoom };
+    }
+
+    // Number of cells covered by the whole screen
+    glm::ivec2 visible_size() const {
+        return scale_to_world(level_size, zoom);
+    }
+
+    // Screen columns [first, last) that show a cell of the level, every other column shows the void
+    std::pair<int, int> visible_columns() const {
+        int first, last;
+        if (zoom >= 0) {
+            first = -position.x * (1 << zoom);
+            last = (level_size.x - position.x) * (1 << zoom);
+        } else {
+            // Rounded up, since a column is only inside the level if the cell it starts on is
+            first = -(position.x >> -zoom);
+            last = -((position.x - level_size.x) >> -zoom);
+        }
+        return { std::clamp(first, 0, level_size.x), std::clamp(last, 0, level_size.x) };
+    }
+
+    // Pans by a number of screen pixels, moving at least one cell when zoomed in
+    void pan(const glm::ivec2 screen_delta) {
+        auto delta = scale_to_world(screen_delta, zoom);
+        position.x += delta.x == 0 ? (screen_delta.x > 0) - (screen_delta.x < 0) : delta.x;
+        position.y += delta.y == 0 ? (screen_delta.y > 0) - (screen_delta.y < 0) : delta.y;
+        clamp();
+    }
+
+    // Changes the zoom while keeping the cell under the given screen pixel in place
+    void zoom_about(const glm::ivec2 screen, const int delta) {
+        auto anchor = to_world(screen);
+        zoom = std::clamp(zoom + delta, min_zoom, max_zoom);
+        position = anchor - scale_to_world(screen, zoom);
+        clamp();
+    }
+
+    void reset() {
+        position = { 0, 0 };
+        zoom = 0;
+    }
+
+private:
+    static glm::ivec2 scale_to_world(const glm::ivec2 screen, const int zoom) {
+        if (zoom >= 0) {
+            return { screen.x >> zoom, screen.y >> zoom };
+        }
+        return { screen.x << -zoom, screen.y << -zoom };
+    }
+
+    // Keeps the centre of the screen inside the level so it cannot be panned away and lost
+    void clamp() {
+        auto half = visible_size() / 2;
+        position.x = std::clamp(position.x, -half.x, level_size.x - half.x);
+        position.y = std::clamp(position.y, -half.y, level_size.y - half.y);
+    }
+};
+
+#endif // PIXELS_CAMERA_H
@@ -0,0 +1,180 @@
+#include "capture.h"
+#include "definitions.h"
+#include "image.h"
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_pixels.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <glm/ext/vector_int2.hpp>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+FrameCapture::FrameCapture(
+    std::filesystem::path output,
+    const Format format,
+    const glm::ivec2 frame_size,
+    const int fps,
+    const size_t queue_capacity
+)
+    : output(std::move(output)), format(format), frame_size(frame_size) {
+    switch (format) {
+        case Format::Y4M: {
+            stream.open(this->output, std::ios::binary);
+            if (not stream) {
+                SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Could not open %s for capture", this->output.string().c_str());
+                return;
+            }
+            write_y4m_header(stream, frame_size, fps);
+            break;
+        }
+        case Format::PNGSequence: {
+            std::error_code error;
+            std::filesystem::create_directories(this->output, error);
+            if (error) {
+                SDL_LogError(
+                    SDL_LOG_CATEGORY_CUSTOM,
+                    "Could not create %s for capture: %s",
+                    this->output.string().c_str(),
+                    error.message().c_str()
+                );
+                return;
+            }
+            break;
+        }
+    }
+
+    // One buffer per queue slot plus the one the writer is currently encoding
+    for (size_t i = 0; i < queue_capacity + 1; i++) {
+        free_frames.push_back(std::make_unique<Frame>(static_cast<size_t>(frame_size.x) * frame_size.y));
+    }
+
+    open = true;
+    writer = std::jthread([this](std::stop_token stop) { run(std::move(stop)); });
+}
+
+FrameCapture::~FrameCapture() {
+    close();
+}
+
+void FrameCapture::close() {
+    open = false;
+    if (writer.joinable()) {
+        // The writer drains whatever is still queued before it exits
+        writer.request_stop();
+        writer.join();
+    }
+    if (stream.is_open()) {
+        // Whatever is still buffered only reaches the disk here
+        stream.close();
+        if (not stream) {
+            SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Could not finish writing %s", output.string().c_str());
+        }
+    }
+}
+
+void FrameCapture::submit(const SDL_Color *pixels) {
+    if (not open) {
+        return;
+    }
+
+    std::unique_ptr<Frame> frame;
+    {
+        std::scoped_lock lock(mutex);
+        if (free_frames.empty()) {
+            dropped++;
+            return;
+        }
+        frame = std::move(free_frames.back());
+        free_frames.pop_back();
+    }
+
+    memcpy(reinterpret_cast<void *>(frame->data()), pixels, frame->size() * sizeof(SDL_Color));
+
+    {
+        std::scoped_lock lock(mutex);
+        queued_frames.push_back(std::move(frame));
+    }
+    frame_ready.notify_one();
+}
+
+uint64_t FrameCapture::frames_written() const {
+    std::scoped_lock lock(mutex);
+    return written;
+}
+
+uint64_t FrameCapture::frames_dropped() const {
+    std::scoped_lock lock(mutex);
+    return dropped;
+}
+
+uint64_t FrameCapture::frames_failed() const {
+    std::scoped_lock lock(mutex);
+    return failed;
+}
+
+void FrameCapture::run(std::stop_token stop) {
+    while (true) {
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock lock(mutex);
+            frame_ready.wait(lock, stop, [this] { return not queued_frames.empty(); });
+            if (queued_frames.empty()) {
+                // Only reachable once a stop has been requested and the queue has been drained
+                return;
+            }
+            frame = std::move(queued_frames.front());
+            queued_frames.pop_front();
+        }
+
+        auto success = write(*frame);
+
+        {
+            std::scoped_lock lock(mutex);
+            success ? written++ : failed++;
+            free_frames.push_back(std::move(frame));
+        }
+    }
+}
+
+bool FrameCapture::write(Frame &frame) {
+    for (auto &pixel : frame) {
+        pixel = composite_over(pixel, background_colour);
+    }
+
+    switch (format) {
+        case Format::Y4M: {
+            // Once the stream has failed every later frame would fail too, so only complain the first time
+            if (not stream) {
+                return false;
+            }
+            write_y4m_frame(stream, frame.data(), frame_size);
+            if (not stream) {
+                SDL_LogError(
+                    SDL_LOG_CATEGORY_CUSTOM,
+                    "Could not write frame %llu to %s",
+                    static_cast<unsigned long long>(next_frame_index),
+                    output.string().c_str()
+                );
+                return false;
+            }
+            break;
+        }
+        case Format::PNGSequence: {
+            char name[32];
+            snprintf(name, sizeof(name), "frame-%06llu.png", static_cast<unsigned long long>(next_frame_index));
+            if (not write_png(output / name, frame.data(), frame_size)) {
+                SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Could not write capture frame %s", name);
+                return false;
+            }
+            break;
+        }
+    }
+
+    next_frame_index++;
+    return true;
+}
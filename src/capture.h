@@ -0,0 +1,83 @@
+#ifndef PIXELS_CAPTURE_H
+#define PIXELS_CAPTURE_H
+
+#include <SDL3/SDL_pixels.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <glm/ext/vector_int2.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Records composed frames to disk on a background thread.
+ *
+ * The simulation thread copies each frame into a buffer taken from a fixed pool and queues it for the writer. The pool
+ * holds exactly one more buffer than the queue can, so the only way submit can fail is if the writer has fallen behind,
+ * in which case the frame is dropped and counted instead of waiting for the disk.
+ */
+class FrameCapture {
+public:
+    enum class Format {
+        Y4M,
+        PNGSequence,
+    };
+
+    // For Y4M, output is the stream file. For PNG sequences it is the directory the frames are written to.
+    FrameCapture(std::filesystem::path output, Format format, glm::ivec2 frame_size, int fps, size_t queue_capacity = 8);
+    ~FrameCapture();
+
+    FrameCapture(FrameCapture const &) = delete;
+    void operator=(FrameCapture const &x) = delete;
+
+    bool is_open() const {
+        return open;
+    }
+
+    const std::filesystem::path &path() const {
+        return output;
+    }
+
+    // Stops accepting frames and waits for the writer to flush everything already queued
+    void close();
+
+    // Copies a tightly packed frame of frame_size pixels. Never blocks on the writer.
+    void submit(const SDL_Color *pixels);
+
+    uint64_t frames_written() const;
+
+    uint64_t frames_dropped() const;
+
+    // Frames that reached the writer but could not be written, e.g. because the disk is full
+    uint64_t frames_failed() const;
+
+private:
+    using Frame = std::vector<SDL_Color>;
+
+    void run(std::stop_token stop);
+    bool write(Frame &frame);
+
+    std::filesystem::path output;
+    Format format;
+    glm::ivec2 frame_size;
+    bool open = false;
+    std::ofstream stream;
+    uint64_t next_frame_index = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable_any frame_ready;
+    std::vector<std::unique_ptr<Frame>> free_frames;
+    std::deque<std::unique_ptr<Frame>> queued_frames;
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t failed = 0;
+
+    // Declared last so the writer is joined before anything it uses is destroyed
+    std::jthread writer;
+};
+
+#endif // PIXELS_CAPTURE_H
@@ -0,0 +1,253 @@
+#include "census.h"
+#include "definitions.h"
+
+#include <array>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/ext/vector_int2.hpp>
+#include <optional>
+#include <utility>
+
+static Region clip_to_level(const Region region) {
+    return Region{ glm::max(region.min, glm::ivec2{ 0, 0 }), glm::min(region.max, level_size) };
+}
+
+static Region chunk_bounds(const glm::ivec2 chunk) {
+    auto min = glm::ivec2{ chunk.x * chunk_size, chunk.y * chunk_size };
+    return Region{ min, glm::min(min + glm::ivec2{ chunk_size, chunk_size }, level_size) };
+}
+
+static Region intersect(const Region a, const Region b) {
+    return Region{ glm::max(a.min, b.min), glm::min(a.max, b.max) };
+}
+
+static bool is_empty(const Region region) {
+    return region.min.x >= region.max.x or region.min.y >= region.max.y;
+}
+
+// Calls f with every chunk touched by the (already clipped) region and the part of the chunk inside the region
+template <typename F> static void for_each_chunk(const Region region, F &&f) {
+    if (is_empty(region)) {
+        return;
+    }
+
+    for (auto y{ region.min.y / chunk_size }; y <= (region.max.y - 1) / chunk_size; y++) {
+        for (auto x{ region.min.x / chunk_size }; x <= (region.max.x - 1) / chunk_size; x++) {
+            auto bounds = chunk_bounds({ x, y });
+            auto overlap = intersect(bounds, region);
+            f(glm::ivec2{ x, y }, overlap, overlap.min == bounds.min and overlap.max == bounds.max);
+        }
+    }
+}
+
+void MaterialCensus::reset(const cell_grid_t &cells) {
+    chunks = {};
+    for (auto y{ 0 }; y < level_size.y; y++) {
+        for (auto x{ 0 }; x < level_size.x; x++) {
+            chunk_at({ x, y }).materials[std::to_underlying(cells[y][x].material)]++;
+        }
+    }
+}
+
+void MaterialCensus::begin_tick() {
+    for (auto &row : chunks) {
+        for (auto &chunk : row) {
+            chunk.moves = 0;
+        }
+    }
+}
+
+int64_t MaterialCensus::total(const Material material) const {
+    int64_t sum = 0;
+    for (const auto &row : chunks) {
+        for (const auto &chunk : row) {
+            sum += chunk.materials[std::to_underlying(material)];
+        }
+    }
+    return sum;
+}
+
+int64_t MaterialCensus::moves() const {
+    int64_t sum = 0;
+    for (const auto &row : chunks) {
+        for (const auto &chunk : row) {
+            sum += chunk.moves;
+        }
+    }
+    return sum;
+}
+
+int64_t MaterialCensus::count(const cell_grid_t &cells, const Region region, const Material material) const {
+    int64_t sum = 0;
+    for_each_chunk(clip_to_level(region), [&](const glm::ivec2 chunk, const Region overlap, const bool whole_chunk) {
+        if (whole_chunk) {
+            sum += chunk_total(chunk, material);
+            return;
+        }
+        if (chunk_total(chunk, material) == 0) {
+            return;
+        }
+
+        for (auto y{ overlap.min.y }; y < overlap.max.y; y++) {
+            for (auto x{ overlap.min.x }; x < overlap.max.x; x++) {
+                sum += cells[y][x].material == material;
+            }
+        }
+    });
+    return sum;
+}
+
+/*
+ * Outermost coordinate along axis (0 for x, 1 for y) of a cell of the material inside the clipped region, looking from
+ * the low side when from_min is set and from the high side otherwise.
+ *
+ * Lines of chunks across the axis are visited starting from that side, skipping chunks whose histogram has none of the
+ * material, and the search stops at the first line with a hit. Inside a chunk the cells are scanned from the same side
+ * and only until they can no longer improve on the best hit so far, so only the chunks along the box's edge are read.
+ */
+static std::optional<int> find_edge(
+    const MaterialCensus &census,
+    const cell_grid_t &cells,
+    const Region region,
+    const Material material,
+    const int axis,
+    const bool from_min
+) {
+    auto other = 1 - axis;
+    auto first_line = region.min[axis] / chunk_size;
+    auto last_line = (region.max[axis] - 1) / chunk_size;
+    auto step = from_min ? 1 : -1;
+
+    for (auto line{ from_min ? first_line : last_line }; line >= first_line and line <= last_line; line += step) {
+        std::optional<int> best;
+        for (auto across{ region.min[other] / chunk_size }; across <= (region.max[other] - 1) / chunk_size; across++) {
+            glm::ivec2 chunk;
+            chunk[axis] = line;
+            chunk[other] = across;
+            if (census.chunk_total(chunk, material) == 0) {
+                continue;
+            }
+
+            auto overlap = intersect(chunk_bounds(chunk), region);
+            auto begin = from_min ? overlap.min[axis] : overlap.max[axis] - 1;
+            auto end = from_min ? overlap.max[axis] : overlap.min[axis] - 1;
+            for (auto along{ begin }; along != end and (not best or along * step < *best * step); along += step) {
+                glm::ivec2 point;
+                point[axis] = along;
+                auto hit = false;
+                for (point[other] = overlap.min[other]; point[other] < overlap.max[other]; point[other]++) {
+                    if (cells[point.y][point.x].material == material) {
+                        hit = true;
+                        break;
+                    }
+                }
+                if (hit) {
+                    best = along;
+                    break;
+                }
+            }
+        }
+
+        if (best) {
+            return best;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<Region>
+MaterialCensus::bounding_box(const cell_grid_t &cells, const Region region, const Material material) const {
+    auto clipped = clip_to_level(region);
+    if (is_empty(clipped)) {
+        return std::nullopt;
+    }
+
+    auto top = find_edge(*this, cells, clipped, material, 1, true);
+    if (not top) {
+        return std::nullopt;
+    }
+
+    // Every other edge has to exist once one does
+    auto bottom = find_edge(*this, cells, clipped, material, 1, false);
+    auto left = find_edge(*this, cells, clipped, material, 0, true);
+    auto right = find_edge(*this, cells, clipped, material, 0, false);
+    return Region{ { *left, *top }, { *right + 1, *bottom + 1 } };
+}
+
+static int64_t brute_force_count(const cell_grid_t &cells, const Region region, const Material material) {
+    int64_t sum = 0;
+    for (auto y{ region.min.y }; y < region.max.y; y++) {
+        for (auto x{ region.min.x }; x < region.max.x; x++) {
+            sum += cells[y][x].material == material;
+        }
+    }
+    return sum;
+}
+
+static std::optional<Region>
+brute_force_bounding_box(const cell_grid_t &cells, const Region region, const Material material) {
+    std::optional<Region> box;
+    for (auto y{ region.min.y }; y < region.max.y; y++) {
+        for (auto x{ region.min.x }; x < region.max.x; x++) {
+            if (cells[y][x].material != material) {
+                continue;
+            }
+            if (not box) {
+                box = Region{ { x, y }, { x + 1, y + 1 } };
+            } else {
+                box->min = glm::min(box->min, glm::ivec2{ x, y });
+                box->max = glm::max(box->max, glm::ivec2{ x + 1, y + 1 });
+            }
+        }
+    }
+    return box;
+}
+
+bool MaterialCensus::verify(const cell_grid_t &cells) const {
+    MaterialCensus recount;
+    recount.reset(cells);
+    for (auto y{ 0 }; y < chunk_count.y; y++) {
+        for (auto x{ 0 }; x < chunk_count.x; x++) {
+            if (recount.chunks[y][x].materials != chunks[y][x].materials) {
+                return false;
+            }
+        }
+    }
+
+    // Moves are attributed to the chunk a cell left from, but the cell itself carries the flag wherever it went
+    int64_t moved = 0;
+    for (const auto &row : cells) {
+        for (const auto &cell : row) {
+            moved += cell.material != Material::Air and cell.has_moved;
+        }
+    }
+    if (moved != moves()) {
+        return false;
+    }
+
+    // The whole level, one region that cuts through chunks on every side and one inside a single chunk
+    auto inset = glm::ivec2{ chunk_size + 7, chunk_size / 2 };
+    const std::array regions{
+        Region{ { 0, 0 }, level_size },
+        Region{ { chunk_size / 2 + 3, chunk_size - 5 }, { level_size.x - inset.x, level_size.y - inset.y } },
+        Region{ { chunk_size + 4, chunk_size + 4 }, { 2 * chunk_size - 4, 2 * chunk_size - 4 } },
+    };
+    for (const auto &region : regions) {
+        for (size_t i = 0; i < material_count; i++) {
+            auto material = static_cast<Material>(i);
+            if (count(cells, region, material) != brute_force_count(cells, region, material)) {
+                return false;
+            }
+
+            auto box = bounding_box(cells, region, material);
+            auto expected = brute_force_bounding_box(cells, region, material);
+            if (box.has_value() != expected.has_value()
+                or (box and (box->min != expected->min or box->max != expected->max))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
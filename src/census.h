@@ -0,0 +1,88 @@
+#ifndef PIXELS_CENSUS_H
+#define PIXELS_CENSUS_H
+
+#include "definitions.h"
+
+#include <array>
+#include <cstdint>
+#include <glm/ext/vector_int2.hpp>
+#include <optional>
+#include <utility>
+
+// Half open rectangle of cells, [min, max)
+struct Region {
+    glm::ivec2 min;
+    glm::ivec2 max;
+};
+
+/*
+ * Per-chunk material histograms and movement counters, kept up to date by the simulator on every swap and brush
+ * write so that nobody has to walk the whole level to find out what is in it.
+ *
+ * Level wide queries only add up the chunk totals. Region queries use the totals for chunks that lie completely
+ * inside the region and only scan cells along its edges.
+ */
+class MaterialCensus {
+public:
+    // Recounts everything from scratch and clears the movement counters
+    void reset(const cell_grid_t &cells);
+
+    void record_write(const glm::ivec2 point, const Material before, const Material after) {
+        auto &chunk = chunk_at(point);
+        chunk.materials[std::to_underlying(before)]--;
+        chunk.materials[std::to_underlying(after)]++;
+    }
+
+    // Called before the cells at a and b are swapped
+    void record_swap(const glm::ivec2 a, const Material at_a, const glm::ivec2 b, const Material at_b) {
+        auto &chunk_a = chunk_at(a);
+        auto &chunk_b = chunk_at(b);
+        if (&chunk_a != &chunk_b) {
+            chunk_a.materials[std::to_underlying(at_a)]--;
+            chunk_a.materials[std::to_underlying(at_b)]++;
+            chunk_b.materials[std::to_underlying(at_b)]--;
+            chunk_b.materials[std::to_underlying(at_a)]++;
+        }
+    }
+
+    // Called once per tick for every non-air cell, the first time it leaves point
+    void record_move(const glm::ivec2 point) {
+        chunk_at(point).moves++;
+    }
+
+    // Clears the movement counters, called at the start of every physics step
+    void begin_tick();
+
+    int64_t total(Material material) const;
+
+    // Number of non-air cells that changed position during the last physics step, however far they went. Cells pushed
+    // aside by something sinking through them count too. Zero once the level has settled.
+    int64_t moves() const;
+
+    int32_t chunk_total(const glm::ivec2 chunk, const Material material) const {
+        return chunks[chunk.y][chunk.x].materials[std::to_underlying(material)];
+    }
+
+    int64_t count(const cell_grid_t &cells, Region region, Material material) const;
+
+    // Smallest region containing every cell of the material inside the given region, if there are any
+    std::optional<Region> bounding_box(const cell_grid_t &cells, Region region, Material material) const;
+
+    // Compares every counter and a sample of region queries against a brute force recount. Has to be called before
+    // the cells' has_moved flags are cleared. Only meant for tests and debug builds.
+    bool verify(const cell_grid_t &cells) const;
+
+private:
+    struct ChunkCensus {
+        std::array<int32_t, material_count> materials{};
+        int32_t moves = 0;
+    };
+
+    ChunkCensus &chunk_at(const glm::ivec2 point) {
+        return chunks[point.y / chunk_size][point.x / chunk_size];
+    }
+
+    std::array<std::array<ChunkCensus, chunk_count.x>, chunk_count.y> chunks{};
+};
+
+#endif // PIXELS_CENSUS_H
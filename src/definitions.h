@@ -3,6 +3,7 @@
 
 #include <SDL3/SDL_pixels.h>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <glm/ext/vector_float2.hpp>
 #include <glm/ext/vector_int2.hpp>
@@ -11,6 +12,13 @@
 constexpr static glm::ivec2 level_size{ 640, 480 };
 constexpr static auto window_size{ level_size * 2 };
 
+// The level is divided into square chunks so per-region bookkeeping does not have to touch every cell
+constexpr static int chunk_size = 32;
+constexpr static glm::ivec2 chunk_count{
+    (level_size.x + chunk_size - 1) / chunk_size,
+    (level_size.y + chunk_size - 1) / chunk_size,
+};
+
 enum class Material : int8_t {
     Air = 0,
     Sand = 1,
@@ -19,6 +27,8 @@ enum class Material : int8_t {
     END_MARKER,
 };
 
+constexpr static size_t material_count = std::to_underlying(Material::END_MARKER);
+
 constexpr static std::array material_colour{
     SDL_Color{ 0, 0, 0, 0 },
     SDL_Color{ 236, 196, 131, 255 },
@@ -44,25 +54,44 @@ static_assert(material_colour.size() == std::to_underlying(Material::END_MARKER)
 static_assert(material_density.size() == std::to_underlying(Material::END_MARKER));
 static_assert(material_slipperiness.size() == std::to_underlying(Material::END_MARKER));
 
+// Per-world copy of the tunable material properties, defaulting to the tables above
+struct MaterialTable {
+    std::array<float, material_count> density = material_density;
+    std::array<int, material_count> slipperiness = material_slipperiness;
+};
+
 constexpr static int g = 1;
 constexpr static int max_y_velocity = 8;
 constexpr static int min_y_velocity = -8;
 
 constexpr static SDL_Color background_colour{ 93, 88, 90, 255 };
 constexpr static SDL_Color cursor_colour{ 255, 255, 255, 64 };
+// Anything outside the level when the camera is panned or zoomed out
+constexpr static SDL_Color void_colour{ 40, 37, 38, 255 };
 
 constexpr static int min_radius = 1;
 constexpr static int max_radius = 100;
 
+// Zooming out by 2^n reads from mip level n, so the furthest zoom out is bounded by how many levels are kept
+constexpr static int mip_level_count = 3;
+constexpr static int min_zoom = -mip_level_count;
+constexpr static int max_zoom = 3;
+constexpr static int pan_speed = 8;
+
+static_assert(chunk_size >> mip_level_count > 0);
+static_assert(level_size.x % (1 << mip_level_count) == 0 and level_size.y % (1 << mip_level_count) == 0);
+
 typedef struct cell_t {
     glm::ivec2 velocity;   // 8 bytes
     Material material;     // 1 byte
     bool has_been_updated; // 1 byte
     bool displaceable;     // 1 byte
+    bool has_moved;        // 1 byte, set the first time the cell changes position in a tick
     //    bool destructible;      // 1 byte
 
     constexpr cell_t(glm::vec2 velocity, Material material, bool has_been_updated, bool displacable)
-        : velocity(velocity), material(material), has_been_updated(has_been_updated), displaceable(displacable) {}
+        : velocity(velocity), material(material), has_been_updated(has_been_updated), displaceable(displacable),
+          has_moved(false) {}
 
     constexpr cell_t() : cell_t({ 0, 0 }, Material::Air, true, true) {}
 
@@ -71,4 +100,7 @@ typedef struct cell_t {
 
 constexpr static cell_t air_cell{ { 0, 0 }, Material::Air, true, true };
 
+typedef std::array<std::array<cell_t, level_size.x>, level_size.y> cell_grid_t;
+typedef std::array<std::array<bool, chunk_count.x>, chunk_count.y> chunk_flags_t;
+
 #endif // PIXELS_DEFINITIONS_H
@@ -0,0 +1,134 @@
+#include "image.h"
+
+#include <SDL3/SDL_pixels.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <glm/ext/vector_int2.hpp>
+#include <ostream>
+#include <vector>
+
+SDL_Color composite_over(const SDL_Color colour, const SDL_Color background) {
+    auto blend = [&](const Uint8 c, const Uint8 b) {
+        return static_cast<Uint8>((c * colour.a + b * (255 - colour.a) + 127) / 255);
+    };
+
+    return SDL_Color{ blend(colour.r, background.r), blend(colour.g, background.g), blend(colour.b, background.b), 255 };
+}
+
+static constexpr auto crc_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; n++) {
+        auto c = n;
+        for (auto k{ 0 }; k < 8; k++) {
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+}();
+
+static uint32_t crc32(const uint8_t *data, const size_t length, uint32_t crc = 0xffffffffu) {
+    for (size_t i = 0; i < length; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void push_be32(std::vector<uint8_t> &out, const uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void write_chunk(std::ofstream &file, const char (&type)[5], const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    push_be32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    // The CRC covers the chunk type and data but not the length
+    push_be32(chunk, crc32(chunk.data() + 4, chunk.size() - 4) ^ 0xffffffffu);
+    file.write(reinterpret_cast<const char *>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+bool write_png(const std::filesystem::path &path, const SDL_Color *pixels, const glm::ivec2 size) {
+    std::ofstream file(path, std::ios::binary);
+    if (not file) {
+        return false;
+    }
+
+    constexpr uint8_t signature[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    push_be32(header, static_cast<uint32_t>(size.x));
+    push_be32(header, static_cast<uint32_t>(size.y));
+    // Bit depth 8, colour type 6 (RGBA), default compression, filter and interlace methods
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+    write_chunk(file, "IHDR", header);
+
+    // Every scanline is prefixed with its filter type, which is always 0 (None) here
+    const auto row_bytes = static_cast<size_t>(size.x) * sizeof(SDL_Color);
+    std::vector<uint8_t> raw;
+    raw.reserve((row_bytes + 1) * size.y);
+    for (auto y{ 0 }; y < size.y; y++) {
+        const auto *row = reinterpret_cast<const uint8_t *>(pixels + static_cast<size_t>(y) * size.x);
+        raw.push_back(0);
+        raw.insert(raw.end(), row, row + row_bytes);
+    }
+
+    // zlib stream made of stored deflate blocks, which are capped at 65535 bytes each
+    std::vector<uint8_t> data;
+    data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    data.insert(data.end(), { 0x78, 0x01 });
+    size_t offset = 0;
+    do {
+        const auto block = std::min<size_t>(raw.size() - offset, 65535);
+        const auto final_block = offset + block == raw.size();
+        data.push_back(final_block ? 1 : 0);
+        data.push_back(static_cast<uint8_t>(block));
+        data.push_back(static_cast<uint8_t>(block >> 8));
+        data.push_back(static_cast<uint8_t>(~block));
+        data.push_back(static_cast<uint8_t>(~block >> 8));
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + block);
+        offset += block;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (const auto byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    push_be32(data, (b << 16) | a);
+    write_chunk(file, "IDAT", data);
+
+    write_chunk(file, "IEND", {});
+    return static_cast<bool>(file);
+}
+
+void write_y4m_header(std::ostream &out, const glm::ivec2 size, const int fps) {
+    out << "YUV4MPEG2 W" << size.x << " H" << size.y << " F" << fps << ":1 Ip A1:1 C444\n";
+}
+
+void write_y4m_frame(std::ostream &out, const SDL_Color *pixels, const glm::ivec2 size) {
+    const auto plane_size = static_cast<size_t>(size.x) * size.y;
+    std::vector<uint8_t> planes(plane_size * 3);
+    auto *y_plane = planes.data();
+    auto *u_plane = y_plane + plane_size;
+    auto *v_plane = u_plane + plane_size;
+
+    // BT.601 limited range, which is what most players assume for Y4M without a colour range tag
+    for (size_t i = 0; i < plane_size; i++) {
+        const int r = pixels[i].r, g = pixels[i].g, b = pixels[i].b;
+        y_plane[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u_plane[i] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v_plane[i] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    out << "FRAME\n";
+    out.write(reinterpret_cast<const char *>(planes.data()), static_cast<std::streamsize>(planes.size()));
+}
@@ -0,0 +1,30 @@
+#ifndef PIXELS_IMAGE_H
+#define PIXELS_IMAGE_H
+
+#include <SDL3/SDL_pixels.h>
+#include <cstdint>
+#include <filesystem>
+#include <glm/ext/vector_int2.hpp>
+#include <ostream>
+
+/*
+ * The frame buffer keeps air fully transparent and lets the renderer's clear colour show through. Anything that leaves
+ * the window (captures, snapshots) has to do that blend itself so the output looks like what is on screen.
+ */
+SDL_Color composite_over(SDL_Color colour, SDL_Color background);
+
+/*
+ * Writes a tightly packed RGBA image as a PNG. The image data is stored uncompressed (deflate "stored" blocks), which
+ * keeps the encoder dependency free and cheap enough to run per frame at the cost of larger files.
+ */
+bool write_png(const std::filesystem::path &path, const SDL_Color *pixels, glm::ivec2 size);
+
+/*
+ * Appends one YUV4MPEG2 "C444" frame (including the FRAME marker) to an already opened stream. The stream header is
+ * written by write_y4m_header.
+ */
+void write_y4m_header(std::ostream &out, glm::ivec2 size, int fps);
+
+void write_y4m_frame(std::ostream &out, const SDL_Color *pixels, glm::ivec2 size);
+
+#endif // PIXELS_IMAGE_H
@@ -1,15 +1,24 @@
 #define SDL_MAIN_USE_CALLBACKS
 
 #include "AppContext.h"
+#include "batch.h"
+#include "capture.h"
 #include "definitions.h"
+#include "perf_counters.h"
 #include "simulator.h"
 #include "util.h"
 
+#ifdef PIXELS_SHM
+#include "shm_layout.h"
+#include "shm_publisher.h"
+#endif
+
 // Can't remove this include
 #include <SDL3/SDL_main.h>
 
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_init.h>
+#include <SDL3/SDL_keyboard.h>
 #include <SDL3/SDL_keycode.h>
 #include <SDL3/SDL_log.h>
 #include <SDL3/SDL_mouse.h>
@@ -18,10 +27,103 @@
 #include <SDL3/SDL_surface.h>
 #include <SDL3/SDL_timer.h>
 #include <SDL3/SDL_video.h>
+#include <cstdint>
+#include <ctime>
 #include <glm/ext/vector_float2.hpp>
+#include <memory>
+#include <optional>
+#include <string>
 #include <utility>
 
-SDL_AppResult SDL_AppInit(void **appstate, [[maybe_unused]] int argc, [[maybe_unused]] char *argv[]) {
+static void toggle_capture(AppContext *app, const FrameCapture::Format format) {
+    if (app->capture) {
+        app->capture->close();
+        SDL_Log(
+            "Stopped capture to %s (%llu frames written, %llu dropped, %llu failed)",
+            app->capture->path().string().c_str(),
+            static_cast<unsigned long long>(app->capture->frames_written()),
+            static_cast<unsigned long long>(app->capture->frames_dropped()),
+            static_cast<unsigned long long>(app->capture->frames_failed())
+        );
+        app->capture.reset();
+        return;
+    }
+
+    char timestamp[32];
+    auto now = std::time(nullptr);
+    std::tm local{};
+    // std::localtime shares a static buffer between threads and MSVC warns about it
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    std::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &local);
+    auto path = std::string("capture-") + timestamp + (format == FrameCapture::Format::Y4M ? ".y4m" : "");
+
+    app->capture = std::make_unique<FrameCapture>(path, format, level_size, 60);
+    if (not app->capture->is_open()) {
+        app->capture.reset();
+        return;
+    }
+
+    SDL_Log("Capturing to %s", path.c_str());
+}
+
+// Batch mode never opens a window. Returns nothing when the arguments do not ask for it.
+static std::optional<SDL_AppResult> run_batch_mode(int argc, char *argv[]) {
+    std::optional<std::string> batch_file;
+    std::optional<std::string> perf_interval;
+    BatchOptions options;
+    for (auto i{ 1 }; i < argc; i++) {
+        std::string arg = argv[i];
+        auto has_value = i + 1 < argc and argv[i + 1][0] != '-';
+        if ((arg == "--batch" or arg == "--out" or arg == "--threads") and not has_value) {
+            SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "%s needs a value", arg.c_str());
+            return SDL_APP_FAILURE;
+        }
+
+        if (arg == "--batch") {
+            batch_file = argv[++i];
+        } else if (arg == "--out") {
+            options.output = argv[++i];
+        } else if (arg == "--threads") {
+            char *end = nullptr;
+            options.threads = SDL_strtoull(argv[++i], &end, 10);
+            if (end == argv[i] or *end != '\0') {
+                SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "--threads expects a number, not '%s'", argv[i]);
+                return SDL_APP_FAILURE;
+            }
+        } else if (arg == "--perf-counters") {
+            options.perf_counters = true;
+            if (i + 1 < argc and SDL_isdigit(argv[i + 1][0])) {
+                perf_interval = argv[++i];
+            }
+        }
+    }
+
+    if (not batch_file) {
+        return std::nullopt;
+    }
+
+    // Worker counters are only summarised once the batch is done, so an interval would silently do nothing
+    if (perf_interval) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "--perf-counters does not take an interval in batch mode");
+        return SDL_APP_FAILURE;
+    }
+
+    auto configs = parse_batch_file(*batch_file);
+    if (not configs) {
+        return SDL_APP_FAILURE;
+    }
+    return run_batch(*configs, options) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+}
+
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
+    if (auto result = run_batch_mode(argc, argv)) {
+        return *result;
+    }
+
     if (not SDL_Init(SDL_INIT_VIDEO)) {
         return SDL_Fail();
     }
@@ -71,10 +173,39 @@ SDL_AppResult SDL_AppInit(void **appstate, [[maybe_unused]] int argc, [[maybe_un
         }
     }
 
-    *appstate = new AppContext{
+    auto *app = new AppContext{
         window,
         renderer,
     };
+    *appstate = app;
+
+    for (auto i{ 1 }; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--perf-counters") {
+            // Optionally followed by how many ticks to average over between reports
+            uint64_t interval = 60;
+            if (i + 1 < argc and SDL_isdigit(argv[i + 1][0])) {
+                interval = SDL_strtoull(argv[++i], nullptr, 10);
+            }
+            app->perf = std::make_unique<PerfCounters>(interval);
+            if (not app->perf->available()) {
+                app->perf.reset();
+            }
+        } else if (arg == "--shm") {
+#ifdef PIXELS_SHM
+            // The segment name is optional and defaults to shared_frame_default_name
+            std::string name = i + 1 < argc and argv[i + 1][0] == '/' ? argv[++i] : shared_frame_default_name;
+            app->publisher = std::make_unique<SharedFramePublisher>(name);
+            if (app->publisher->is_open()) {
+                SDL_Log("Publishing frames to shared memory segment %s", name.c_str());
+            } else {
+                app->publisher.reset();
+            }
+#else
+            SDL_Log("Shared memory publishing is not supported on this platform");
+#endif
+        }
+    }
 
     SDL_Log("Application started successfully!");
 
@@ -87,7 +218,12 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
 
     switch (event->type) {
         case SDL_EVENT_MOUSE_WHEEL: {
-            if (event->wheel.y > 0) {
+            if (SDL_GetModState() & SDL_KMOD_CTRL) {
+                if (event->wheel.y != 0) {
+                    const auto &[mouse_pos, mouse_state] = get_mouse_info(app->renderer);
+                    app->camera.zoom_about(mouse_pos, event->wheel.y > 0 ? 1 : -1);
+                }
+            } else if (event->wheel.y > 0) {
                 app->cursor.brush_radius = std::min(app->cursor.brush_radius + 1, max_radius);
             } else if (event->wheel.y < 0) {
                 app->cursor.brush_radius = std::max(app->cursor.brush_radius - 1, min_radius);
@@ -97,8 +233,9 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
         case SDL_EVENT_MOUSE_BUTTON_DOWN: {
             switch (event->button.button) {
                 case SDL_BUTTON_MIDDLE: {
-                    if (check_in_lvl_range({ event->button.x, event->button.y })) {
-                        app->cursor.selected_material = app->cells[event->button.y][event->button.x].material;
+                    auto point = app->camera.to_world({ event->button.x, event->button.y });
+                    if (check_in_lvl_range(point)) {
+                        app->cursor.selected_material = app->world.cells[point.y][point.x].material;
                     }
                     break;
                 }
@@ -123,6 +260,26 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
                     SDL_Log("Selected material: Red Sand");
                     break;
                 }
+                case SDLK_EQUALS: {
+                    app->camera.zoom_about(level_size / 2, 1);
+                    break;
+                }
+                case SDLK_MINUS: {
+                    app->camera.zoom_about(level_size / 2, -1);
+                    break;
+                }
+                case SDLK_HOME: {
+                    app->camera.reset();
+                    break;
+                }
+                case SDLK_F9: {
+                    toggle_capture(app, FrameCapture::Format::Y4M);
+                    break;
+                }
+                case SDLK_F10: {
+                    toggle_capture(app, FrameCapture::Format::PNGSequence);
+                    break;
+                }
                 case SDLK_F11: {
                     SDL_SetWindowFullscreen(app->window, SDL_GetWindowFlags(app->window) & SDL_WINDOW_FULLSCREEN ? SDL_FALSE : SDL_TRUE);
                     break;
@@ -153,9 +310,23 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
     auto begin{ SDL_GetTicks() };
     auto *app = (AppContext *)appstate;
 
-    process_input(app);
-    process_physics(app);
+    {
+        PerfPhase phase(app->perf.get(), PerfCounters::Phase::Input);
+        process_input(app);
+    }
+    {
+        PerfPhase phase(app->perf.get(), PerfCounters::Phase::Physics);
+        process_physics(app);
+    }
+#ifdef PIXELS_SHM
+    if (app->publisher) {
+        app->publisher->publish(*app);
+    }
+#endif
     process_rendering(app);
+    if (app->perf) {
+        app->perf->end_tick();
+    }
 
     auto elapsed_ticks = SDL_GetTicks() - begin;
     if (elapsed_ticks < 16) {
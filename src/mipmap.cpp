@@ -0,0 +1,78 @@
+#include "mipmap.h"
+#include "definitions.h"
+
+#include <SDL3/SDL_pixels.h>
+#include <algorithm>
+#include <glm/ext/vector_int2.hpp>
+#include <utility>
+
+MipChain::MipChain() {
+    for (auto level{ 1 }; level <= mip_level_count; level++) {
+        auto level_texels = size(level);
+        // An empty level is all air, which is fully transparent
+        levels[level - 1].assign(static_cast<size_t>(level_texels.x) * level_texels.y, SDL_Color{ 0, 0, 0, 0 });
+    }
+}
+
+/*
+ * Air is transparent, so a plain average would darken the edges of everything next to it. Weighting the colour by
+ * alpha keeps the colour of whatever is there and lets the coverage fade out through alpha instead.
+ */
+static SDL_Color average(const SDL_Color a, const SDL_Color b, const SDL_Color c, const SDL_Color d) {
+    int alpha = a.a + b.a + c.a + d.a;
+    if (alpha == 0) {
+        return SDL_Color{ 0, 0, 0, 0 };
+    }
+
+    auto channel = [&](const Uint8 SDL_Color::*member) {
+        auto sum = a.*member * a.a + b.*member * b.a + c.*member * c.a + d.*member * d.a;
+        return static_cast<Uint8>((sum + alpha / 2) / alpha);
+    };
+
+    return SDL_Color{ channel(&SDL_Color::r), channel(&SDL_Color::g), channel(&SDL_Color::b), static_cast<Uint8>(alpha / 4) };
+}
+
+void MipChain::update(const cell_grid_t &cells, const chunk_flags_t &dirty_chunks) {
+    for (auto y{ 0 }; y < chunk_count.y; y++) {
+        for (auto x{ 0 }; x < chunk_count.x; x++) {
+            if (dirty_chunks[y][x]) {
+                rebuild_chunk(cells, { x, y });
+            }
+        }
+    }
+}
+
+void MipChain::rebuild_chunk(const cell_grid_t &cells, const glm::ivec2 chunk) {
+    auto cell_colour = [&](const int x, const int y) {
+        return material_colour[std::to_underlying(cells[y][x].material)];
+    };
+
+    for (auto level{ 1 }; level <= mip_level_count; level++) {
+        auto begin = glm::ivec2{ (chunk.x * chunk_size) >> level, (chunk.y * chunk_size) >> level };
+        auto level_texels = size(level);
+        auto end = glm::ivec2{ std::min(begin.x + (chunk_size >> level), level_texels.x),
+                               std::min(begin.y + (chunk_size >> level), level_texels.y) };
+
+        auto *dst = levels[level - 1].data();
+        const auto *src = level > 1 ? levels[level - 2].data() : nullptr;
+        auto src_width = size(level - 1).x;
+
+        for (auto y{ begin.y }; y < end.y; y++) {
+            for (auto x{ begin.x }; x < end.x; x++) {
+                auto sx = x * 2, sy = y * 2;
+                if (src) {
+                    auto *row = src + sy * src_width;
+                    auto *next_row = row + src_width;
+                    dst[y * level_texels.x + x] = average(row[sx], row[sx + 1], next_row[sx], next_row[sx + 1]);
+                } else {
+                    dst[y * level_texels.x + x] = average(
+                        cell_colour(sx, sy),
+                        cell_colour(sx + 1, sy),
+                        cell_colour(sx, sy + 1),
+                        cell_colour(sx + 1, sy + 1)
+                    );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef PIXELS_MIPMAP_H
+#define PIXELS_MIPMAP_H
+
+#include "definitions.h"
+
+#include <SDL3/SDL_pixels.h>
+#include <array>
+#include <glm/ext/vector_int2.hpp>
+#include <vector>
+
+/*
+ * Downsampled copies of the level's colours used when the camera is zoomed out.
+ *
+ * Level n is level_size / 2^n texels, each the alpha weighted average of the 2x2 texels below it (level 0 being the
+ * cells themselves). Only chunks that changed since the last update are rebuilt, so keeping the chain current costs
+ * nothing while the level is at rest.
+ */
+class MipChain {
+public:
+    MipChain();
+
+    static glm::ivec2 size(int level) {
+        return { level_size.x >> level, level_size.y >> level };
+    }
+
+    // level is in [1, mip_level_count]
+    const SDL_Color *texels(const int level) const {
+        return levels[level - 1].data();
+    }
+
+    void update(const cell_grid_t &cells, const chunk_flags_t &dirty_chunks);
+
+private:
+    void rebuild_chunk(const cell_grid_t &cells, glm::ivec2 chunk);
+
+    std::array<std::vector<SDL_Color>, mip_level_count> levels;
+};
+
+#endif // PIXELS_MIPMAP_H
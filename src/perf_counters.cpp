@@ -0,0 +1,269 @@
+#include "perf_counters.h"
+
+#include <SDL3/SDL_log.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static constexpr std::array phase_names{ "input", "physics", "paint", "upload" };
+static constexpr std::array counter_names{ "cycles", "instr", "L1D miss", "LLC miss", "branch miss" };
+
+static_assert(phase_names.size() == static_cast<size_t>(PerfCounters::Phase::END_MARKER));
+static_assert(counter_names.size() == static_cast<size_t>(PerfCounters::Counter::END_MARKER));
+
+#ifdef __linux__
+static constexpr uint64_t cache_event(const uint64_t cache, const uint64_t op, const uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+static int open_counter(const PerfCounters::Counter counter, const int group_fd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The group can still be multiplexed with other users of the PMU, the times let us scale the result back up
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+        case PerfCounters::Counter::Cycles: {
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        }
+        case PerfCounters::Counter::Instructions: {
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        }
+        case PerfCounters::Counter::L1DMisses: {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_event(
+                PERF_COUNT_HW_CACHE_L1D,
+                PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS
+            );
+            break;
+        }
+        case PerfCounters::Counter::LLCMisses: {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_event(
+                PERF_COUNT_HW_CACHE_LL,
+                PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS
+            );
+            break;
+        }
+        case PerfCounters::Counter::BranchMisses: {
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+        case PerfCounters::Counter::END_MARKER: {
+            return -1;
+        }
+    }
+
+    // This thread only, on whichever CPU it happens to run
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+
+PerfCounters::PerfCounters(const uint64_t report_interval) : report_interval(report_interval) {
+    fds.fill(-1);
+
+#ifdef __linux__
+    for (size_t i = 0; i < counter_count; i++) {
+        fds[i] = open_counter(static_cast<Counter>(i), leader);
+        if (fds[i] >= 0) {
+            if (leader < 0) {
+                leader = fds[i];
+            }
+            group_index[i] = group_size++;
+        } else {
+            SDL_LogWarn(
+                SDL_LOG_CATEGORY_CUSTOM,
+                "Performance counter '%s' is unavailable: %s",
+                counter_names[i],
+                strerror(errno)
+            );
+        }
+    }
+
+    if (not available()) {
+        SDL_LogWarn(
+            SDL_LOG_CATEGORY_CUSTOM,
+            "No performance counters could be opened, check that the CPU exposes a PMU and "
+            "/proc/sys/kernel/perf_event_paranoid"
+        );
+    }
+#else
+    SDL_LogWarn(SDL_LOG_CATEGORY_CUSTOM, "Performance counters are only supported on Linux");
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    // Members first, so the leader goes last
+    for (auto fd : fds) {
+        if (fd >= 0 and fd != leader) {
+            close(fd);
+        }
+    }
+    if (leader >= 0) {
+        close(leader);
+    }
+#endif
+}
+
+bool PerfCounters::available() const {
+    return leader >= 0;
+}
+
+void PerfCounters::read_all(Reading &reading) const {
+    reading = Reading{};
+#ifdef __linux__
+    // Laid out as the number of counters, both times and then one value per counter in the order they joined
+    std::array<uint64_t, 3 + counter_count> buffer{};
+    auto expected = static_cast<ssize_t>((3 + group_size) * sizeof(uint64_t));
+    if (read(leader, buffer.data(), sizeof(buffer)) != expected) {
+        return;
+    }
+
+    reading.time_enabled = buffer[1];
+    reading.time_running = buffer[2];
+    for (size_t i = 0; i < counter_count; i++) {
+        if (fds[i] >= 0) {
+            reading.values[i] = buffer[3 + group_index[i]];
+        }
+    }
+#endif
+}
+
+void PerfCounters::begin(const Phase phase) {
+    if (not available()) {
+        return;
+    }
+    read_all(phase_start[static_cast<size_t>(phase)]);
+}
+
+void PerfCounters::end(const Phase phase) {
+    if (not available()) {
+        return;
+    }
+
+    Reading now;
+    read_all(now);
+
+    auto index = static_cast<size_t>(phase);
+    const auto &start = phase_start[index];
+    auto enabled = now.time_enabled - start.time_enabled;
+    auto running = now.time_running - start.time_running;
+    // Someone else held the PMU for the whole phase, the values did not move and mean nothing
+    if (running == 0) {
+        unscheduled[index]++;
+        return;
+    }
+
+    // Every counter in the group was running for the same share of the time, so they all scale alike
+    auto scale = running < enabled ? static_cast<double>(enabled) / static_cast<double>(running) : 1.0;
+
+    measured[index]++;
+    auto &total = totals[index];
+    for (size_t i = 0; i < counter_count; i++) {
+        total[i] += static_cast<double>(now.values[i] - start.values[i]) * scale;
+    }
+}
+
+void PerfCounters::end_tick() {
+    if (not available()) {
+        return;
+    }
+
+    if (++ticks < report_interval or report_interval == 0) {
+        return;
+    }
+
+    SDL_Log(
+        "Performance counters over the last %llu ticks, average per measured tick:\n%s",
+        static_cast<unsigned long long>(ticks),
+        summary().c_str()
+    );
+    for (auto &phase : totals) {
+        phase.fill(0.0);
+    }
+    measured.fill(0);
+    unscheduled.fill(0);
+    ticks = 0;
+}
+
+static std::string format_count(const double value) {
+    char buffer[32];
+    if (value >= 1e9) {
+        snprintf(buffer, sizeof(buffer), "%.2fG", value / 1e9);
+    } else if (value >= 1e6) {
+        snprintf(buffer, sizeof(buffer), "%.2fM", value / 1e6);
+    } else if (value >= 1e3) {
+        snprintf(buffer, sizeof(buffer), "%.2fk", value / 1e3);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%.0f", value);
+    }
+    return buffer;
+}
+
+std::string PerfCounters::summary() const {
+    std::string result;
+
+    for (size_t phase = 0; phase < phase_count; phase++) {
+        const auto &total = totals[phase];
+        // Runners that only step the physics never enter the other phases
+        if (measured[phase] == 0 and unscheduled[phase] == 0) {
+            continue;
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "%-8s", phase_names[phase]);
+        result += name;
+
+        if (measured[phase] == 0) {
+            result += "  n/a, the counters were never scheduled (is something else using the PMU?)\n";
+            continue;
+        }
+
+        auto divisor = static_cast<double>(measured[phase]);
+        for (size_t i = 0; i < counter_count; i++) {
+            result += "  ";
+            result += counter_names[i];
+            result += ' ';
+            result += fds[i] >= 0 ? format_count(total[i] / divisor) : "n/a";
+        }
+
+        auto cycles = total[static_cast<size_t>(Counter::Cycles)];
+        auto instructions = total[static_cast<size_t>(Counter::Instructions)];
+        if (cycles > 0 and fds[static_cast<size_t>(Counter::Instructions)] >= 0) {
+            char ipc[24];
+            snprintf(ipc, sizeof(ipc), "  IPC %.2f", instructions / cycles);
+            result += ipc;
+        }
+
+        if (unscheduled[phase] > 0) {
+            char missed[64];
+            snprintf(
+                missed,
+                sizeof(missed),
+                "  (not scheduled %llu times)",
+                static_cast<unsigned long long>(unscheduled[phase])
+            );
+            result += missed;
+        }
+        result += '\n';
+    }
+
+    return result;
+}
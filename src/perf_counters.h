@@ -0,0 +1,105 @@
+#ifndef PIXELS_PERF_COUNTERS_H
+#define PIXELS_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*
+ * Optional hardware performance counters (Linux perf_event_open) broken down by phase of the main loop.
+ *
+ * Counters are per thread and only count user space. They are opened as a single group so the PMU always schedules them
+ * together, which keeps ratios such as IPC meaningful even when the kernel has to multiplex, and every phase boundary
+ * costs a single read. Any counter the kernel or CPU refuses is reported as unavailable and the rest keep working. When
+ * none can be opened, begin/end do nothing. On other platforms nothing is ever available.
+ */
+class PerfCounters {
+public:
+    enum class Phase {
+        Input,
+        Physics,
+        Paint,
+        Upload,
+        END_MARKER,
+    };
+
+    enum class Counter {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        BranchMisses,
+        END_MARKER,
+    };
+
+    // Results are logged and reset every report_interval calls to end_tick, or never if it is 0
+    explicit PerfCounters(uint64_t report_interval);
+    ~PerfCounters();
+
+    PerfCounters(PerfCounters const &) = delete;
+    void operator=(PerfCounters const &x) = delete;
+
+    bool available() const;
+
+    void begin(Phase phase);
+
+    void end(Phase phase);
+
+    void end_tick();
+
+    // Average of every phase since the last report over the times it was measured, one line per phase. A phase whose
+    // counters never got scheduled onto the PMU is reported as unavailable.
+    std::string summary() const;
+
+private:
+    static constexpr auto phase_count = static_cast<size_t>(Phase::END_MARKER);
+    static constexpr auto counter_count = static_cast<size_t>(Counter::END_MARKER);
+
+    // Shared by the whole group, since its counters are only ever scheduled together
+    struct Reading {
+        uint64_t time_enabled;
+        uint64_t time_running;
+        std::array<uint64_t, counter_count> values;
+    };
+
+    void read_all(Reading &reading) const;
+
+    // The first counter that opens leads the group, the others join it
+    int leader = -1;
+    std::array<int, counter_count> fds;
+    // Position of each counter in the group's read buffer, which follows the order they joined in
+    std::array<size_t, counter_count> group_index{};
+    size_t group_size = 0;
+    std::array<Reading, phase_count> phase_start{};
+    std::array<std::array<double, counter_count>, phase_count> totals{};
+    // How often each phase was measured, and how often the group was not running at all so nothing could be measured
+    std::array<uint64_t, phase_count> measured{};
+    std::array<uint64_t, phase_count> unscheduled{};
+    uint64_t report_interval;
+    uint64_t ticks = 0;
+};
+
+// Counts the enclosing scope towards a phase. Does nothing when counters is null.
+class PerfPhase {
+public:
+    PerfPhase(PerfCounters *counters, const PerfCounters::Phase phase) : counters(counters), phase(phase) {
+        if (counters) {
+            counters->begin(phase);
+        }
+    }
+
+    ~PerfPhase() {
+        if (counters) {
+            counters->end(phase);
+        }
+    }
+
+    PerfPhase(PerfPhase const &) = delete;
+    void operator=(PerfPhase const &x) = delete;
+
+private:
+    PerfCounters *counters;
+    PerfCounters::Phase phase;
+};
+
+#endif // PIXELS_PERF_COUNTERS_H
@@ -0,0 +1,59 @@
+#ifndef PIXELS_SHM_LAYOUT_H
+#define PIXELS_SHM_LAYOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Layout of the shared-memory segment written by SharedFramePublisher and read by SharedFrameReader.
+ *
+ * The segment starts with a SharedFrameHeader, followed by slot_count slots spaced slot_stride bytes apart. Each slot
+ * is a SharedFrameSlot immediately followed by width * height material bytes (row major, one int8_t per cell).
+ *
+ * Slots are written round robin and each one is guarded by a seqlock: the sequence is odd while the publisher is
+ * writing the slot and even once it is complete. A reader samples the sequence, reads the slot in place and then
+ * checks that the sequence has not changed. This header deliberately does not depend on SDL or glm so that external
+ * tools can include it on its own.
+ */
+
+constexpr static uint32_t shared_frame_magic = 0x534c5850; // "PXLS"
+constexpr static uint32_t shared_frame_version = 2;
+constexpr static uint32_t shared_frame_slot_count = 4;
+constexpr static const char *shared_frame_default_name = "/pixels";
+
+struct SharedFrameHeader {
+    // Stored last by the publisher, so readers can tell a segment that is still being set up
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t material_count;
+    uint32_t slot_count;
+    uint64_t slot_stride;
+    // Process id of the publisher, so a new one can tell a live segment from one left behind by a crash
+    int64_t publisher_pid;
+    // Number of frames published so far. The newest frame lives in slot (published - 1) % slot_count.
+    alignas(64) std::atomic<uint64_t> published;
+};
+
+struct SharedFrameSlot {
+    alignas(64) std::atomic<uint64_t> sequence;
+    uint64_t tick;
+    uint64_t hash;
+    uint32_t active_chunks;
+    uint32_t reserved;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free and std::atomic<uint64_t>::is_always_lock_free);
+
+constexpr static size_t shared_frame_slot_stride(const uint32_t width, const uint32_t height) {
+    auto size = sizeof(SharedFrameSlot) + static_cast<size_t>(width) * height;
+    return (size + 63) / 64 * 64;
+}
+
+constexpr static size_t shared_frame_segment_size(const uint32_t width, const uint32_t height) {
+    return sizeof(SharedFrameHeader) + shared_frame_slot_stride(width, height) * shared_frame_slot_count;
+}
+
+#endif // PIXELS_SHM_LAYOUT_H
@@ -0,0 +1,181 @@
+#include "shm_publisher.h"
+#include "AppContext.h"
+#include "definitions.h"
+#include "shm_layout.h"
+#include "world.h"
+
+#include <SDL3/SDL_log.h>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <optional>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+// Process id of the publisher that owns an existing segment, if that process is still running
+static std::optional<pid_t> live_publisher(const std::string &name) {
+    auto existing = shm_open(name.c_str(), O_RDONLY, 0);
+    if (existing < 0) {
+        return std::nullopt;
+    }
+
+    struct stat info{};
+    std::optional<pid_t> owner;
+    if (fstat(existing, &info) == 0 and static_cast<size_t>(info.st_size) >= sizeof(SharedFrameHeader)) {
+        auto *memory = mmap(nullptr, sizeof(SharedFrameHeader), PROT_READ, MAP_SHARED, existing, 0);
+        if (memory != MAP_FAILED) {
+            const auto *header = static_cast<const SharedFrameHeader *>(memory);
+            // Segments from an older layout or from a publisher that died during set up are never considered live
+            if (header->magic.load(std::memory_order_acquire) == shared_frame_magic
+                and header->version == shared_frame_version) {
+                auto pid = static_cast<pid_t>(header->publisher_pid);
+                // EPERM means the process exists but belongs to someone else
+                if (pid > 0 and (kill(pid, 0) == 0 or errno == EPERM)) {
+                    owner = pid;
+                }
+            }
+            munmap(memory, sizeof(SharedFrameHeader));
+        }
+    }
+
+    close(existing);
+    return owner;
+}
+
+SharedFramePublisher::SharedFramePublisher(std::string name) : name(std::move(name)) {
+    size = shared_frame_segment_size(level_size.x, level_size.y);
+
+    if (auto owner = live_publisher(this->name)) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_CUSTOM,
+            "Shared memory segment %s is already in use by process %lld",
+            this->name.c_str(),
+            static_cast<long long>(*owner)
+        );
+        return;
+    }
+
+    // Whatever is left under the name belongs to a publisher that is no longer running. Readers that still have it
+    // mapped keep their old pages, and the new segment is created exclusively and sized exactly once, which is all
+    // macOS allows.
+    shm_unlink(this->name.c_str());
+    fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 and errno == EEXIST) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Another publisher created %s at the same time", this->name.c_str());
+        return;
+    }
+    if (fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "shm_open(%s) failed: %s", this->name.c_str(), strerror(errno));
+        return;
+    }
+
+    auto fail = [this](const char *call) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "%s(%s) failed: %s", call, this->name.c_str(), strerror(errno));
+        close(fd);
+        shm_unlink(this->name.c_str());
+        fd = -1;
+    };
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        fail("ftruncate");
+        return;
+    }
+
+    auto *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        fail("mmap");
+        return;
+    }
+
+    auto *new_header = new (memory) SharedFrameHeader{};
+    new_header->version = shared_frame_version;
+    new_header->width = level_size.x;
+    new_header->height = level_size.y;
+    new_header->material_count = std::to_underlying(Material::END_MARKER);
+    new_header->slot_count = shared_frame_slot_count;
+    new_header->slot_stride = shared_frame_slot_stride(level_size.x, level_size.y);
+    new_header->publisher_pid = getpid();
+    new_header->published.store(0, std::memory_order_relaxed);
+
+    auto *slots = reinterpret_cast<std::byte *>(new_header + 1);
+    for (uint32_t i = 0; i < shared_frame_slot_count; i++) {
+        new (slots + i * new_header->slot_stride) SharedFrameSlot{};
+    }
+
+    new_header->magic.store(shared_frame_magic, std::memory_order_release);
+    header = new_header;
+}
+
+SharedFramePublisher::~SharedFramePublisher() {
+    if (header) {
+        munmap(header, size);
+    }
+    if (fd >= 0) {
+        // Another instance may have replaced our segment since, in which case the name is no longer ours to remove
+        if (still_owns_name()) {
+            shm_unlink(name.c_str());
+        }
+        close(fd);
+    }
+}
+
+bool SharedFramePublisher::still_owns_name() const {
+    auto current = shm_open(name.c_str(), O_RDONLY, 0);
+    if (current < 0) {
+        return false;
+    }
+
+    struct stat ours{};
+    struct stat theirs{};
+    auto same = fstat(fd, &ours) == 0 and fstat(current, &theirs) == 0 and ours.st_dev == theirs.st_dev
+                and ours.st_ino == theirs.st_ino;
+    close(current);
+    return same;
+}
+
+void SharedFramePublisher::publish(const AppContext &app) {
+    if (not header) {
+        return;
+    }
+
+    auto published = header->published.load(std::memory_order_relaxed);
+    auto *base = reinterpret_cast<std::byte *>(header + 1) + (published % shared_frame_slot_count) * header->slot_stride;
+    auto *slot = reinterpret_cast<SharedFrameSlot *>(base);
+    auto *materials = reinterpret_cast<int8_t *>(slot + 1);
+
+    auto sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Same as World::hash, computed while the material plane is being copied anyway
+    auto hash = World::hash_seed;
+    for (auto y{ 0 }; y < level_size.y; y++) {
+        auto *row = materials + y * level_size.x;
+        for (auto x{ 0 }; x < level_size.x; x++) {
+            auto material = app.world.cells[y][x].material;
+            row[x] = std::to_underlying(material);
+            hash = World::hash_step(hash, material);
+        }
+    }
+
+    uint32_t active_chunks = 0;
+    for (const auto &row : app.world.active_chunks) {
+        for (const auto active : row) {
+            active_chunks += active;
+        }
+    }
+
+    slot->tick = app.world.tick;
+    slot->hash = hash;
+    slot->active_chunks = active_chunks;
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    header->published.store(published + 1, std::memory_order_release);
+}
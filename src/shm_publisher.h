@@ -0,0 +1,45 @@
+#ifndef PIXELS_SHM_PUBLISHER_H
+#define PIXELS_SHM_PUBLISHER_H
+
+#include "shm_layout.h"
+
+#include <cstddef>
+#include <string>
+
+struct AppContext;
+
+/*
+ * Publishes the material plane and per-tick metadata into a POSIX shared-memory ring buffer (see shm_layout.h) so that
+ * external tools can follow the simulation without scraping the window. Each publisher creates a fresh segment and
+ * refuses to start while another running publisher owns the name. A segment left behind by a crashed run is replaced,
+ * and the segment is unlinked again on destruction unless another publisher has taken the name since.
+ */
+class SharedFramePublisher {
+public:
+    explicit SharedFramePublisher(std::string name);
+    ~SharedFramePublisher();
+
+    SharedFramePublisher(SharedFramePublisher const &) = delete;
+    void operator=(SharedFramePublisher const &x) = delete;
+
+    bool is_open() const {
+        return header != nullptr;
+    }
+
+    const std::string &segment_name() const {
+        return name;
+    }
+
+    // Meant to be called once per tick after the physics step, before the active chunk flags are cleared
+    void publish(const AppContext &app);
+
+private:
+    bool still_owns_name() const;
+
+    std::string name;
+    int fd = -1;
+    size_t size = 0;
+    SharedFrameHeader *header = nullptr;
+};
+
+#endif // PIXELS_SHM_PUBLISHER_H
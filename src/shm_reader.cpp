@@ -0,0 +1,123 @@
+#include "shm_reader.h"
+#include "shm_layout.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+SharedFrameReader::SharedFrameReader(std::string name) : name(std::move(name)) {
+    auto fd = shm_open(this->name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        last_error = "shm_open failed: " + std::string(strerror(errno));
+        return;
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 or static_cast<size_t>(info.st_size) < sizeof(SharedFrameHeader)) {
+        last_error = "segment is too small to contain a header";
+        close(fd);
+        return;
+    }
+
+    size = static_cast<size_t>(info.st_size);
+    auto *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the segment alive on its own
+    close(fd);
+    if (memory == MAP_FAILED) {
+        last_error = "mmap failed: " + std::string(strerror(errno));
+        return;
+    }
+
+    auto *mapped = static_cast<const SharedFrameHeader *>(memory);
+    if (mapped->magic.load(std::memory_order_acquire) != shared_frame_magic) {
+        last_error = "segment has not been initialised by a publisher";
+    } else if (mapped->version != shared_frame_version) {
+        last_error = "segment version " + std::to_string(mapped->version) + " is not supported";
+    } else if (mapped->slot_count != shared_frame_slot_count
+               or mapped->slot_stride != shared_frame_slot_stride(mapped->width, mapped->height)) {
+        // slot() indexes with these, so they have to describe exactly the layout the size check below assumes
+        last_error = "segment has an unexpected slot layout";
+    } else if (size < shared_frame_segment_size(mapped->width, mapped->height)) {
+        last_error = "segment is smaller than its header claims";
+    } else {
+        header = mapped;
+        return;
+    }
+
+    munmap(memory, size);
+}
+
+SharedFrameReader::~SharedFrameReader() {
+    if (header) {
+        munmap(const_cast<SharedFrameHeader *>(header), size);
+    }
+}
+
+uint32_t SharedFrameReader::width() const {
+    return header ? header->width : 0;
+}
+
+uint32_t SharedFrameReader::height() const {
+    return header ? header->height : 0;
+}
+
+uint32_t SharedFrameReader::material_count() const {
+    return header ? header->material_count : 0;
+}
+
+uint64_t SharedFrameReader::published() const {
+    return header ? header->published.load(std::memory_order_acquire) : 0;
+}
+
+const SharedFrameSlot *SharedFrameReader::slot(const uint64_t index) const {
+    auto *base = reinterpret_cast<const std::byte *>(header + 1);
+    return reinterpret_cast<const SharedFrameSlot *>(base + (index % header->slot_count) * header->slot_stride);
+}
+
+std::optional<SharedFrameView> SharedFrameReader::latest() const {
+    if (not header) {
+        return std::nullopt;
+    }
+
+    // A couple of retries covers the publisher wrapping around onto the slot we picked while we were reading it
+    for (auto attempt{ 0 }; attempt < 4; attempt++) {
+        auto published = header->published.load(std::memory_order_acquire);
+        if (published == 0) {
+            return std::nullopt;
+        }
+
+        const auto *frame = slot(published - 1);
+        auto sequence = frame->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+
+        SharedFrameView view{
+            frame->tick,
+            frame->hash,
+            frame->active_chunks,
+            header->width,
+            header->height,
+            reinterpret_cast<const int8_t *>(frame + 1),
+            frame,
+            sequence,
+        };
+        if (still_valid(view)) {
+            return view;
+        }
+    }
+
+    return std::nullopt;
+}
+
+bool SharedFrameReader::still_valid(const SharedFrameView &view) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
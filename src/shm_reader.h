@@ -0,0 +1,73 @@
+#ifndef PIXELS_SHM_READER_H
+#define PIXELS_SHM_READER_H
+
+#include "shm_layout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/*
+ * A frame as it sits in shared memory. materials points straight into the mapped segment, so the publisher may
+ * overwrite it at any time. Consume the view and then call SharedFrameReader::still_valid to find out whether what was
+ * read is trustworthy.
+ */
+struct SharedFrameView {
+    uint64_t tick;
+    uint64_t hash;
+    uint32_t active_chunks;
+    uint32_t width;
+    uint32_t height;
+    const int8_t *materials;
+
+    const SharedFrameSlot *slot;
+    uint64_t sequence;
+};
+
+/*
+ * Read-only mapping of a segment created by SharedFramePublisher. Nothing here ever writes to the segment, so any
+ * number of readers can follow one publisher without it noticing.
+ */
+class SharedFrameReader {
+public:
+    explicit SharedFrameReader(std::string name = shared_frame_default_name);
+    ~SharedFrameReader();
+
+    SharedFrameReader(SharedFrameReader const &) = delete;
+    void operator=(SharedFrameReader const &x) = delete;
+
+    bool is_open() const {
+        return header != nullptr;
+    }
+
+    // Human readable reason for the last failure to open the segment
+    const std::string &error() const {
+        return last_error;
+    }
+
+    uint32_t width() const;
+
+    uint32_t height() const;
+
+    uint32_t material_count() const;
+
+    // Total number of frames published so far
+    uint64_t published() const;
+
+    // The newest complete frame, or nothing if no frame has been published or the publisher lapped the reader
+    std::optional<SharedFrameView> latest() const;
+
+    // True if the frame behind view was not touched by the publisher since latest() returned it
+    bool still_valid(const SharedFrameView &view) const;
+
+private:
+    const SharedFrameSlot *slot(uint64_t index) const;
+
+    std::string name;
+    std::string last_error;
+    size_t size = 0;
+    const SharedFrameHeader *header = nullptr;
+};
+
+#endif // PIXELS_SHM_READER_H
@@ -1,49 +1,90 @@
 #include "simulator.h"
 #include "AppContext.h"
 #include "definitions.h"
+#include "mipmap.h"
+#include "perf_counters.h"
 #include "util.h"
+#include "world.h"
 
+#include <SDL3/SDL_assert.h>
+#include <SDL3/SDL_keyboard.h>
 #include <SDL3/SDL_mouse.h>
 #include <SDL3/SDL_pixels.h>
 #include <SDL3/SDL_render.h>
+#include <algorithm>
 #include <cstring>
 #include <glm/ext/vector_int2.hpp>
 #include <utility>
 
+static void mark_chunk_active(World &world, const glm::ivec2 point) {
+    world.active_chunks[point.y / chunk_size][point.x / chunk_size] = true;
+}
+
+// Air filling the space something left behind does not count as movement
+static void record_move(World &world, cell_t &cell, const glm::ivec2 from) {
+    if (cell.material != Material::Air and not cell.has_moved) {
+        cell.has_moved = true;
+        world.census.record_move(from);
+    }
+}
+
+static void swap_cells(World &world, const glm::ivec2 a, const glm::ivec2 b) {
+    auto &cell_a = world.cells[a.y][a.x];
+    auto &cell_b = world.cells[b.y][b.x];
+    world.census.record_swap(a, cell_a.material, b, cell_b.material);
+    record_move(world, cell_a, a);
+    record_move(world, cell_b, b);
+    std::swap(cell_a, cell_b);
+    mark_chunk_active(world, a);
+    mark_chunk_active(world, b);
+}
+
+void paint_brush(World &world, const glm::ivec2 centre, const int radius, const Material material) {
+    const cell_t brush_cell{ { 0, 0 }, material, true, true };
+    for (auto i{ centre.y - radius }; i < centre.y + radius; i++) {
+        for (auto j{ centre.x - radius }; j < centre.x + radius; j++) {
+            if (check_in_lvl_range({ j, i })) {
+                world.census.record_write({ j, i }, world.cells[i][j].material, material);
+                world.cells[i][j] = brush_cell;
+                mark_chunk_active(world, { j, i });
+            }
+        }
+    }
+}
+
 void process_input(AppContext *app) {
-    //    auto kb_state{SDL_GetKeyboardState(nullptr)};
+    auto kb_state{ SDL_GetKeyboardState(nullptr) };
+    glm::ivec2 pan{ 0, 0 };
+    if (kb_state[SDL_SCANCODE_LEFT]) {
+        pan.x -= pan_speed;
+    }
+    if (kb_state[SDL_SCANCODE_RIGHT]) {
+        pan.x += pan_speed;
+    }
+    if (kb_state[SDL_SCANCODE_UP]) {
+        pan.y -= pan_speed;
+    }
+    if (kb_state[SDL_SCANCODE_DOWN]) {
+        pan.y += pan_speed;
+    }
+    if (pan != glm::ivec2{ 0, 0 }) {
+        app->camera.pan(pan);
+    }
+
     const auto &[mouse_pos, mouse_state] = get_mouse_info(app->renderer);
-    auto radius = app->cursor.brush_radius;
-    auto brush_top_left = glm::ivec2{ mouse_pos.x - radius, mouse_pos.y - radius };
-    auto brush_bottom_right = glm::ivec2{ mouse_pos.x + radius, mouse_pos.y + radius };
-    auto brush_top_right = glm::ivec2{ mouse_pos.x + radius, mouse_pos.y - radius };
-    auto brush_bottom_left = glm::ivec2{ mouse_pos.x - radius, mouse_pos.y + radius };
+    auto brush_centre = app->camera.to_world(mouse_pos);
 
     if (mouse_state & SDL_BUTTON(SDL_BUTTON_LEFT)) {
-        for (auto i{ brush_top_left.y }; i < brush_bottom_right.y; i++) {
-            for (auto j{ brush_top_left.x }; j < brush_bottom_right.x; j++) {
-                if (check_in_lvl_range({ j, i })) {
-                    auto &cell = app->cells[i][j];
-                    cell.material = app->cursor.selected_material;
-                    cell.has_been_updated = true;
-                    cell.displaceable = true;
-                    cell.velocity = { 0, 0 };
-                }
-            }
-        }
+        paint_brush(app->world, brush_centre, app->cursor.brush_radius, app->cursor.selected_material);
     } else if (mouse_state & SDL_BUTTON(SDL_BUTTON_RIGHT)) {
-        for (auto i{ brush_top_left.y }; i < brush_bottom_right.y; i++) {
-            for (auto j{ brush_top_left.x }; j < brush_bottom_right.x; j++) {
-                if (check_in_lvl_range({ j, i })) {
-                    app->cells[i][j] = air_cell;
-                }
-            }
-        }
+        paint_brush(app->world, brush_centre, app->cursor.brush_radius, Material::Air);
     }
 }
 
-void process_physics(AppContext *app) {
-    bool flip = app->rng.gen_real() > 0.5f;
+void step_world(World &world) {
+    world.census.begin_tick();
+
+    bool flip = world.rng.gen_real() > 0.5f;
 
     for (auto y{ level_size.y - 1 }; y >= 0; y--) {
         /*
@@ -57,13 +98,13 @@ void process_physics(AppContext *app) {
         auto dx = flip ? 1 : -1;
 
         for (auto x{ x_start }; x != x_end; x += dx) {
-            auto &cell = app->cells[y][x];
+            auto &cell = world.cells[y][x];
 
             if (cell.has_been_updated) {
                 continue;
             }
 
-            bool flip2 = app->rng.gen_real() > 0.5f;
+            bool flip2 = world.rng.gen_real() > 0.5f;
 
             switch (cell.material) {
                 case Material::END_MARKER:
@@ -88,8 +129,8 @@ void process_physics(AppContext *app) {
                             break;
                         }
 
-                        auto &next_cell = app->cells[next.y][next.x];
-                        if (next_cell.displaceable and density_le_chance(next_cell, cell, app->rng)) {
+                        auto &next_cell = world.cells[next.y][next.x];
+                        if (next_cell.displaceable and density_le_chance(next_cell, cell, world.materials, world.rng)) {
                             s_y++;
                         } else {
                             // The particle hit something that is not displaceable and/or
@@ -115,11 +156,11 @@ void process_physics(AppContext *app) {
                         // We can fall down by s_y cells
                         // Since we are falling vertically, we cannot use memmove
                         for (auto i{ 0 }; i < s_y; i++) {
-                            auto &cur = app->cells[y + i][x];
-                            auto &next = app->cells[y + i + 1][x];
+                            auto &cur = world.cells[y + i][x];
+                            auto &next = world.cells[y + i + 1][x];
                             cur.has_been_updated = true;
                             next.has_been_updated = true;
-                            std::swap(cur, next);
+                            swap_cells(world, { x, y + i }, { x, y + i + 1 });
                         }
                         break;
                     }
@@ -140,11 +181,11 @@ void process_physics(AppContext *app) {
                         continue;
                     }
 
-                    auto &point_cell = app->cells[test.y][test.x];
-                    if (point_cell.displaceable and density_le_chance(point_cell, cell, app->rng)) {
+                    auto &point_cell = world.cells[test.y][test.x];
+                    if (point_cell.displaceable and density_le_chance(point_cell, cell, world.materials, world.rng)) {
                         cell.has_been_updated = true;
                         point_cell.has_been_updated = true;
-                        std::swap(cell, point_cell);
+                        swap_cells(world, { x, y }, test);
                         break;
                     }
 
@@ -167,8 +208,8 @@ void process_physics(AppContext *app) {
                             break;
                         }
 
-                        auto &next_cell = app->cells[next.y][next.x];
-                        if (next_cell.displaceable and density_le_chance(next_cell, cell, app->rng)) {
+                        auto &next_cell = world.cells[next.y][next.x];
+                        if (next_cell.displaceable and density_le_chance(next_cell, cell, world.materials, world.rng)) {
                             s_y++;
                         } else {
                             // The particle hit something that is not displaceable and/or
@@ -186,11 +227,11 @@ void process_physics(AppContext *app) {
                         // We can fall down by s_y cells
                         // Since we are falling vertically, we cannot use memmove
                         for (auto i{ 0 }; i < s_y; i++) {
-                            auto &cur = app->cells[y + i][x];
-                            auto &next = app->cells[y + i + 1][x];
+                            auto &cur = world.cells[y + i][x];
+                            auto &next = world.cells[y + i + 1][x];
                             cur.has_been_updated = true;
                             next.has_been_updated = true;
-                            std::swap(cur, next);
+                            swap_cells(world, { x, y + i }, { x, y + i + 1 });
                         }
 
                         // Already processed
@@ -217,11 +258,11 @@ void process_physics(AppContext *app) {
                         slip_dir = -1;
                     }
 
-                    auto max_slip = slipperiness(cell) * slip_dir;
+                    auto max_slip = slipperiness(cell, world.materials) * slip_dir;
                     auto s_x = 0;
 
                     while (s_x != max_slip) {
-                        auto &cur_x = app->cells[y][x + s_x];
+                        auto &cur_x = world.cells[y][x + s_x];
                         auto next_x = glm::ivec2{ x + s_x + slip_dir, y };
                         if (not check_x_in_lvl_range(next_x.x)) {
                             cur_x.has_been_updated = true;
@@ -229,19 +270,20 @@ void process_physics(AppContext *app) {
                             break;
                         }
 
-                        auto &next_x_cell = app->cells[next_x.y][next_x.x];
-                        if (next_x_cell.displaceable and density_le_chance(next_x_cell, cur_x, app->rng)) {
+                        auto &next_x_cell = world.cells[next_x.y][next_x.x];
+                        if (next_x_cell.displaceable
+                            and density_le_chance(next_x_cell, cur_x, world.materials, world.rng)) {
                             cur_x.has_been_updated = true;
                             next_x_cell.has_been_updated = true;
-                            std::swap(cur_x, next_x_cell);
+                            swap_cells(world, { x + s_x, y }, next_x);
 
                             // Check if we can fall down
                             // According to people, removing this check actually makes the water seem more realistic
 //                            if (y < level_size.y - 1) {
 //                                auto below = glm::ivec2{ next_x.x, y + 1 };
-//                                auto &next_y_cell = app->cells[below.y][below.x];
+//                                auto &next_y_cell = world.cells[below.y][below.x];
 //                                if (next_y_cell.displaceable
-//                                    and density_le_chance(next_y_cell, next_x_cell, app->rng)) {
+//                                    and density_le_chance(next_y_cell, next_x_cell, world.materials, world.rng)) {
 //                                    next_y_cell.has_been_updated = true;
 //                                    next_x_cell.has_been_updated = true;
 //                                    std::swap(next_y_cell, next_x_cell);
@@ -263,15 +305,30 @@ void process_physics(AppContext *app) {
             }
         }
     }
+
+    world.tick++;
+
+#ifndef NDEBUG
+    // Physics only ever swaps cells, so a full recount must agree with the incremental census and its queries
+    if (world.tick % 64 == 0) {
+        SDL_assert(world.census.verify(world.cells));
+    }
+#endif
+}
+
+void process_physics(AppContext *app) {
+    step_world(app->world);
 }
 
 static void paint_cursor(const AppContext *app, SDL_Color *pixels) {
     const auto &[mouse_pos, mouse_state] = get_mouse_info(app->renderer);
+    // The brush is sized in cells, so its outline is worked out in the level and then projected onto the screen
+    auto centre = app->camera.to_world(mouse_pos);
     auto radius = app->cursor.brush_radius;
-    auto top_left = glm::ivec2{ mouse_pos.x - radius, mouse_pos.y - radius };
-    auto top_right = glm::ivec2{ mouse_pos.x + radius, mouse_pos.y - radius };
-    auto bottom_left = glm::ivec2{ mouse_pos.x - radius, mouse_pos.y + radius };
-    auto bottom_right = glm::ivec2{ mouse_pos.x + radius, mouse_pos.y + radius };
+    auto top_left = app->camera.to_screen({ centre.x - radius, centre.y - radius });
+    auto bottom_right = app->camera.to_screen({ centre.x + radius, centre.y + radius });
+    auto top_right = glm::ivec2{ bottom_right.x, top_left.y };
+    auto bottom_left = glm::ivec2{ top_left.x, bottom_right.y };
 
     for (auto y{ top_left.y }; y <= bottom_right.y; y++) {
         if (check_in_lvl_range({ top_left.x, y })) {
@@ -315,11 +372,55 @@ static void paint_cursor(const AppContext *app, SDL_Color *pixels) {
 }
 
 static void paint_level(AppContext *app, SDL_Color *pixels) {
+    const auto &camera = app->camera;
+    // When zoomed out by 2^level every screen pixel covers exactly one texel of that mip level, so the cost of painting
+    // only depends on the size of the screen and never on how much of the level is visible
+    auto level = std::max(-camera.zoom, 0);
+    const auto *texels = level > 0 ? app->mips.texels(level) : nullptr;
+    auto texel_width = MipChain::size(level).x;
+    auto [first, last] = camera.visible_columns();
+    // Copied out of the camera since the compiler cannot tell that writing pixels leaves it alone
+    auto offset = camera.position.x;
+    auto zoom = camera.zoom;
+
     for (auto y{ 0 }; y < level_size.y; y++) {
-        for (auto x{ 0 }; x < level_size.x; x++) {
-            auto &cell = app->cells[y][x];
-            auto &colour = material_colour[std::to_underlying(cell.material)];
-            memcpy(reinterpret_cast<void *>(pixels + (y * level_size.x + x)), &colour, sizeof(SDL_Color));
+        auto *row = pixels + y * level_size.x;
+        auto world_y = camera.to_world({ 0, y }).y;
+        if (first >= last or world_y < 0 or world_y >= level_size.y) {
+            std::fill(row, row + level_size.x, void_colour);
+            continue;
+        }
+
+        // Zoomed in, 2^zoom screen rows in a row show the same cells
+        if (y > 0 and zoom > 0 and camera.to_world({ 0, y - 1 }).y == world_y) {
+            memcpy(reinterpret_cast<void *>(row), row - level_size.x, level_size.x * sizeof(SDL_Color));
+            continue;
+        }
+
+        std::fill(row, row + first, void_colour);
+        std::fill(row + last, row + level_size.x, void_colour);
+
+        if (texels) {
+            // Consecutive screen columns are consecutive texels, so the whole span is a single copy
+            auto texel_x = (offset >> level) + first;
+            const auto *source = texels + (world_y >> level) * texel_width + texel_x;
+            memcpy(reinterpret_cast<void *>(row + first), source, (last - first) * sizeof(SDL_Color));
+        } else if (zoom == 0) {
+            const auto *cells = app->world.cells[world_y].data() + (offset + first);
+            auto *target = row + first;
+            for (auto x{ 0 }; x < last - first; x++) {
+                const auto &colour = material_colour[std::to_underlying(cells[x].material)];
+                memcpy(reinterpret_cast<void *>(target + x), &colour, sizeof(SDL_Color));
+            }
+        } else {
+            // Each cell covers a run of 2^zoom columns, clipped at the edges of the span
+            const auto &cells = app->world.cells[world_y];
+            for (auto x{ first }; x < last;) {
+                auto run_end = std::min(((x >> zoom) + 1) << zoom, last);
+                const auto &colour = material_colour[std::to_underlying(cells[offset + (x >> zoom)].material)];
+                std::fill(row + x, row + run_end, colour);
+                x = run_end;
+            }
         }
     }
 }
@@ -334,20 +435,25 @@ void process_rendering(AppContext *app) {
     );
     SDL_RenderClear(app->renderer);
 
-    SDL_Color *pixels;
-    int pitch = sizeof(SDL_Color) * level_size.x;
-    SDL_LockTexture(app->frame_buffer, nullptr, reinterpret_cast<void **>(&pixels), &pitch);
+    {
+        PerfPhase phase(app->perf.get(), PerfCounters::Phase::Paint);
+        app->mips.update(app->world.cells, app->world.active_chunks);
 
-    paint_level(app, pixels);
-    paint_cursor(app, pixels);
-
-    SDL_UnlockTexture(app->frame_buffer);
-    SDL_RenderTexture(app->renderer, app->frame_buffer, nullptr, nullptr);
-    SDL_RenderPresent(app->renderer);
-
-    for (auto &row : app->cells) {
-        for (auto &cell : row) {
-            cell.has_been_updated = false;
+        auto *pixels = app->frame.data();
+        paint_level(app, pixels);
+        if (app->capture) {
+            // Captured before the cursor is drawn so recordings only contain the level
+            app->capture->submit(pixels);
         }
+        paint_cursor(app, pixels);
     }
+
+    {
+        PerfPhase phase(app->perf.get(), PerfCounters::Phase::Upload);
+        SDL_UpdateTexture(app->frame_buffer, nullptr, app->frame.data(), sizeof(SDL_Color) * level_size.x);
+        SDL_RenderTexture(app->renderer, app->frame_buffer, nullptr, nullptr);
+        SDL_RenderPresent(app->renderer);
+    }
+
+    app->world.end_tick();
 }
\ No newline at end of file
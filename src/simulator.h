@@ -2,6 +2,16 @@
 #define PIXELS_SIMULATOR_H
 
 #include "AppContext.h"
+#include "definitions.h"
+#include "world.h"
+
+#include <glm/ext/vector_int2.hpp>
+
+// Fills a square brush with fresh cells of the material, Material::Air erases
+void paint_brush(World &world, glm::ivec2 centre, int radius, Material material);
+
+// Advances the world by one tick. World::end_tick has to be called before the next step.
+void step_world(World &world);
 
 void process_input(AppContext *app);
 
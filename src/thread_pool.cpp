@@ -0,0 +1,98 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Which pool and deque the current thread works for, so tasks can resubmit onto their own deque
+static thread_local const WorkStealingPool *current_pool = nullptr;
+static thread_local size_t current_index = 0;
+
+WorkStealingPool::WorkStealingPool(const size_t thread_count) {
+    auto count = std::max<size_t>(thread_count, 1);
+    for (size_t i = 0; i < count; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < count; i++) {
+        workers.emplace_back([this, i](std::stop_token stop) { run(std::move(stop), i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    for (auto &worker : workers) {
+        worker.request_stop();
+    }
+    // The jthreads join on destruction
+}
+
+void WorkStealingPool::submit(Task task) {
+    auto index = current_pool == this ? current_index : next_queue.fetch_add(1) % queues.size();
+
+    // Counted before the task is published, so a worker that pops it straight away cannot take queued below zero, and
+    // under the idle lock so a worker cannot check for work and then miss the notification
+    pending.fetch_add(1);
+    {
+        std::scoped_lock lock(idle_mutex);
+        queued.fetch_add(1);
+    }
+    {
+        std::scoped_lock lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    work_available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock lock(idle_mutex);
+    all_done.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::try_pop(const size_t index, Task &task) {
+    {
+        auto &own = *queues[index];
+        std::scoped_lock lock(own.mutex);
+        if (not own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        auto &victim = *queues[(index + offset) % queues.size()];
+        std::scoped_lock lock(victim.mutex);
+        if (not victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::run(std::stop_token stop, const size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (not stop.stop_requested()) {
+        Task task;
+        if (try_pop(index, task)) {
+            task();
+            if (pending.fetch_sub(1) == 1) {
+                std::scoped_lock lock(idle_mutex);
+                all_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock lock(idle_mutex);
+        work_available.wait(lock, stop, [this] { return queued.load() > 0; });
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef PIXELS_THREAD_POOL_H
+#define PIXELS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed size pool where every worker owns a deque of tasks.
+ *
+ * Tasks submitted from inside a task go to the back of the current worker's own deque and are taken from the back
+ * again, so a task that resubmits itself tends to stay on the same thread and keep its data in cache. Idle workers
+ * steal from the front of other workers' deques, which spreads work across cores without any tuning.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t thread_count);
+    ~WorkStealingPool();
+
+    WorkStealingPool(WorkStealingPool const &) = delete;
+    void operator=(WorkStealingPool const &x) = delete;
+
+    size_t size() const {
+        return queues.size();
+    }
+
+    void submit(Task task);
+
+    // Blocks until every submitted task, including ones submitted by other tasks, has finished
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(std::stop_token stop, size_t index);
+    bool try_pop(size_t index, Task &task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> next_queue = 0;
+    // Tasks sitting in (or about to be pushed onto) a deque, and tasks that have not finished running yet
+    std::atomic<size_t> queued = 0;
+    std::atomic<size_t> pending = 0;
+
+    std::mutex idle_mutex;
+    std::condition_variable_any work_available;
+    std::condition_variable all_done;
+
+    // Declared last so the workers are joined before anything they use is destroyed
+    std::vector<std::jthread> workers;
+};
+
+#endif // PIXELS_THREAD_POOL_H
@@ -0,0 +1,93 @@
+/*
+ * Sample consumer for the shared-memory frame publisher.
+ *
+ * Usage: pixels-shm-stats [segment name] [--view]
+ *
+ * Prints the tick, hash, active chunk count and per-material cell counts of the newest frame roughly ten times a
+ * second. With --view it also draws a downsampled text preview of the level.
+ */
+#include "shm_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    std::string name = shared_frame_default_name;
+    bool view = false;
+    for (auto i{ 1 }; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--view") {
+            view = true;
+        } else {
+            name = arg;
+        }
+    }
+
+    SharedFrameReader reader(name);
+    if (not reader.is_open()) {
+        fprintf(stderr, "Could not open %s: %s\n", name.c_str(), reader.error().c_str());
+        return 1;
+    }
+
+    printf("Following %s (%ux%u, %u materials)\n", name.c_str(), reader.width(), reader.height(), reader.material_count());
+
+    constexpr int preview_step = 8;
+    constexpr char preview_glyphs[] = " #~%@*+=";
+    uint64_t last_tick = UINT64_MAX;
+    std::vector<uint64_t> counts(reader.material_count());
+    std::string preview;
+
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        auto frame = reader.latest();
+        if (not frame or frame->tick == last_tick) {
+            continue;
+        }
+
+        // Everything below reads straight out of shared memory and is only trusted once still_valid says so
+        std::fill(counts.begin(), counts.end(), 0);
+        auto cell_count = static_cast<size_t>(frame->width) * frame->height;
+        for (size_t i = 0; i < cell_count; i++) {
+            auto material = static_cast<uint8_t>(frame->materials[i]);
+            if (material < counts.size()) {
+                counts[material]++;
+            }
+        }
+
+        preview.clear();
+        if (view) {
+            for (uint32_t y = 0; y < frame->height; y += preview_step * 2) {
+                for (uint32_t x = 0; x < frame->width; x += preview_step) {
+                    auto material = static_cast<uint8_t>(frame->materials[y * frame->width + x]);
+                    preview += material < sizeof(preview_glyphs) - 1 ? preview_glyphs[material] : '?';
+                }
+                preview += '\n';
+            }
+        }
+
+        if (not reader.still_valid(*frame)) {
+            continue;
+        }
+        last_tick = frame->tick;
+
+        if (view) {
+            // Clear the terminal so the preview redraws in place
+            printf("\033[H\033[2J%s", preview.c_str());
+        }
+        printf("tick %llu  hash %016llx  active chunks %u  cells",
+               static_cast<unsigned long long>(frame->tick),
+               static_cast<unsigned long long>(frame->hash),
+               frame->active_chunks);
+        for (size_t material = 0; material < counts.size(); material++) {
+            printf("  [%zu] %llu", material, static_cast<unsigned long long>(counts[material]));
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+}
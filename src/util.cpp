@@ -11,12 +11,8 @@
 #include <glm/ext/vector_int2.hpp>
 #include <utility>
 
-float density(const cell_t &cell) {
-    return material_density[std::to_underlying(cell.material)];
-}
-
-bool density_le_chance(const cell_t &a, const cell_t &b, Random &rng) {
-    auto diff = density(b) - density(a);
+bool density_le_chance(const cell_t &a, const cell_t &b, const MaterialTable &materials, Random &rng) {
+    auto diff = density(b, materials) - density(a, materials);
     return diff != 0.f && rng.gen_real() < diff;
 }
 
@@ -6,6 +6,7 @@
 #include <SDL3/SDL_init.h>
 #include <SDL3/SDL_mouse.h>
 #include <SDL3/SDL_render.h>
+#include <cstdint>
 #include <glm/ext/vector_int2.hpp>
 #include <pcg_extras.hpp>
 #include <pcg_random.hpp>
@@ -26,6 +27,14 @@ public:
         uni_int = std::uniform_int_distribution<int>(0, 1);
         uni_real = std::uniform_real_distribution<float>(0.f, 1.f);
     }
+
+    // Reproducible sequence, for runs that have to be repeatable
+    explicit Random(const uint64_t seed) {
+        rng.seed(seed);
+
+        uni_int = std::uniform_int_distribution<int>(0, 1);
+        uni_real = std::uniform_real_distribution<float>(0.f, 1.f);
+    }
     ~Random() = default;
 
     Random(Random const &) = delete;
@@ -56,10 +65,12 @@ auto inline colour(const cell_t &cell) {
     return material_colour[std::to_underlying(cell.material)];
 }
 
-float inline density(const cell_t &cell);
+auto inline density(const cell_t &cell, const MaterialTable &materials) {
+    return materials.density[std::to_underlying(cell.material)];
+}
 
-auto inline slipperiness(const cell_t &cell) {
-    return material_slipperiness[std::to_underlying(cell.material)];
+auto inline slipperiness(const cell_t &cell, const MaterialTable &materials) {
+    return materials.slipperiness[std::to_underlying(cell.material)];
 }
 
 std::pair<glm::ivec2, SDL_MouseButtonFlags> get_mouse_info(SDL_Renderer *renderer);
@@ -70,7 +81,7 @@ std::pair<glm::ivec2, SDL_MouseButtonFlags> get_mouse_info(SDL_Renderer *rendere
  * and compare it to a random float in the range [0, 1]. If the random float is less than the difference in densities,
  * then b sinks below a.
  */
-bool density_le_chance(const cell_t &a, const cell_t &b, Random &rng);
+bool density_le_chance(const cell_t &a, const cell_t &b, const MaterialTable &materials, Random &rng);
 
 SDL_AppResult SDL_Fail();
 
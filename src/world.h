@@ -0,0 +1,79 @@
+#ifndef PIXELS_WORLD_H
+#define PIXELS_WORLD_H
+
+#include "census.h"
+#include "definitions.h"
+#include "util.h"
+
+#include <cstdint>
+#include <utility>
+
+/*
+ * Everything the physics step reads and writes. A World knows nothing about SDL, so several of them can be simulated
+ * side by side without a window (see batch.h).
+ */
+struct World {
+    cell_grid_t cells;
+    // Chunks containing at least one cell that was written or moved since the flags were last cleared
+    chunk_flags_t active_chunks;
+    MaterialCensus census;
+    MaterialTable materials;
+    Random rng;
+    uint64_t tick = 0;
+
+    World() {
+        clear();
+    }
+
+    explicit World(const uint64_t seed) : rng(seed) {
+        clear();
+    }
+
+    World(World const &) = delete;
+    void operator=(World const &x) = delete;
+
+    // Fills the level with air
+    void clear() {
+        for (auto &row : cells) {
+            row.fill(air_cell);
+        }
+        for (auto &row : active_chunks) {
+            row.fill(true);
+        }
+        census.reset(cells);
+    }
+
+    // FNV-1a over the material of every cell in row major order. SharedFramePublisher computes the same hash with
+    // hash_step while it copies the cells.
+    static constexpr uint64_t hash_seed = 0xcbf29ce484222325ull;
+
+    static constexpr uint64_t hash_step(const uint64_t hash, const Material material) {
+        return (hash ^ static_cast<uint8_t>(std::to_underlying(material))) * 0x100000001b3ull;
+    }
+
+    uint64_t hash() const {
+        auto hash = hash_seed;
+        for (const auto &row : cells) {
+            for (const auto &cell : row) {
+                hash = hash_step(hash, cell.material);
+            }
+        }
+        return hash;
+    }
+
+    // Has to run between physics steps so every cell gets processed again
+    void end_tick() {
+        for (auto &row : cells) {
+            for (auto &cell : row) {
+                cell.has_been_updated = false;
+                cell.has_moved = false;
+            }
+        }
+
+        for (auto &row : active_chunks) {
+            row.fill(false);
+        }
+    }
+};
+
+#endif // PIXELS_WORLD_H